@@ -9,6 +9,10 @@ ISRS_GEN_C = f"{PATH}/isrs_gen.c"
 ISRS_GEN_ASM = f"{PATH}/isrs_gen.inc"
 ISRS_WITH_ERROR_CODE=[8,10,11,12,13,14,17,21,30]
 
+# hardware IRQs get the lean entry, must match IRQ_VECTOR_BASE in isr_asm.asm
+IRQ_VECTOR_BASE=0x20
+IRQ_COUNT=16
+
 def generate_inc():
 
     inc = Path(ISRS_GEN_ASM)
@@ -17,7 +21,9 @@ def generate_inc():
 
     with open(ISRS_GEN_ASM, 'w') as f:
         for i in range(0, 256):
-            if i in ISRS_WITH_ERROR_CODE:
+            if IRQ_VECTOR_BASE <= i < IRQ_VECTOR_BASE + IRQ_COUNT:
+                f.write(f"IRQ_FAST {i}\r\n")
+            elif i in ISRS_WITH_ERROR_CODE:
                 f.write(f"ISR_ERRORCODE {i}\r\n")
             else:
                 f.write(f"ISR_NOERRORCODE {i}\r\n")
@@ -90,6 +90,12 @@ start:
     ; BIOS should set DL to drive number
     mov [ebr_drive_number], dl
 
+    ; boot timeline: stage1 entry timestamp, picked up by stage2 (see boot/bootinfo.h)
+    ; only after DL is saved, rdtsc clobbers EDX
+    rdtsc
+    mov [STAGE1_TSC_ADDRESS], eax
+    mov [STAGE1_TSC_ADDRESS + 4], edx
+
     ; check extensions present
     mov ah, 41h
     mov bx, 0x55AA
@@ -294,6 +300,8 @@ section .data
     PARTITION_ENTRY_SEGMENT equ 0x2000
     PARTITION_ENTRY_OFFSET  equ 0x0
 
+    STAGE1_TSC_ADDRESS      equ 0x4F0   ; BIOS inter-application communication area
+
 section .data
     global stage2_location
     stage2_location:        times 30 db 0
@@ -1,6 +1,42 @@
 #include "disk.h"
 #include "x86.h"
 #include "stdio.h"
+#include "minmax.h"
+#include "memory.h"
+#include "memdefs.h"
+
+// 127 sectors is the largest transfer that stays inside a single 64 KiB segment,
+// it's also the upper limit of the EDD specification for AH=42h
+#define DISK_MAX_TRANSFER_SECTORS 127
+#define DISK_MAX_TRANSFER_BYTES   0xFFF0
+
+static void DISK_DetectExtensions(DISK* disk)
+{
+    EDD_DriveParameters params;
+
+    disk->extensions = false;
+    disk->bytesPerSector = DISK_SECTOR_SIZE;
+    disk->maxTransferSectors = DISK_MAX_TRANSFER_SECTORS;
+
+    if (!x86_Disk_CheckExtensions(disk->id))
+        return;
+
+    memset(&params, 0, sizeof(params));
+    params.Size = sizeof(params);
+    if (!x86_Disk_GetExtendedDriveParams(disk->id, &params))
+        return;
+
+    // the FAT driver works with 512 byte sectors, anything else keeps using CHS
+    if (params.BytesPerSector != DISK_SECTOR_SIZE)
+    {
+        printf("[DISK] Unsupported sector size %u, extended reads disabled\r\n", params.BytesPerSector);
+        return;
+    }
+
+    disk->extensions = true;
+    disk->bytesPerSector = params.BytesPerSector;
+    disk->maxTransferSectors = min(DISK_MAX_TRANSFER_SECTORS, DISK_MAX_TRANSFER_BYTES / params.BytesPerSector);
+}
 
 bool DISK_Initialize(DISK* disk, uint8_t driveNumber)
 {
@@ -14,6 +50,10 @@ bool DISK_Initialize(DISK* disk, uint8_t driveNumber)
     disk->cylinders = cylinders;
     disk->heads = heads;
     disk->sectors = sectors;
+    disk->readCalls = 0;
+    disk->sectorsRead = 0;
+
+    DISK_DetectExtensions(disk);
 
     return true;
 }
@@ -30,7 +70,7 @@ void DISK_LBA2CHS(DISK* disk, uint32_t lba, uint16_t* cylinderOut, uint16_t* sec
     *headOut = (lba / disk->sectors) % disk->heads;
 }
 
-bool DISK_ReadSectors(DISK* disk, uint32_t lba, uint8_t sectors, void * lowerDataOut)
+bool DISK_ReadSectorsCHS(DISK* disk, uint32_t lba, uint8_t sectors, void * lowerDataOut)
 {
     uint16_t cylinder, sector, head;
 
@@ -45,4 +85,71 @@ bool DISK_ReadSectors(DISK* disk, uint32_t lba, uint8_t sectors, void * lowerDat
     }
 
     return false;
+}
+
+bool DISK_ReadSectorsLBA(DISK* disk, uint32_t lba, uint8_t sectors, void * lowerDataOut)
+{
+    EDD_DiskAddressPacket packet;
+
+    packet.Size = sizeof(packet);
+    packet._Reserved = 0;
+    packet.Count = sectors;
+    packet.Offset = (uint32_t)lowerDataOut & 0xF;
+    packet.Segment = (uint32_t)lowerDataOut >> 4;
+    packet.Lba = lba;
+
+    for (int i = 0; i < 3; i++)
+    {
+        if (x86_Disk_ExtendedRead(disk->id, &packet))
+            return true;
+
+        // the BIOS reports in 'Count' how many sectors were transferred, start over
+        packet.Count = sectors;
+        x86_Disk_Reset(disk->id);
+    }
+
+    return false;
+}
+
+bool DISK_ReadSectors(DISK* disk, uint32_t lba, uint16_t sectors, void * dataOut)
+{
+    uint8_t* u8DataOut = (uint8_t*)dataOut;
+
+    while (sectors > 0)
+    {
+        uint16_t count = min(sectors, disk->maxTransferSectors);
+        bool ok;
+
+        if (!disk->extensions)
+        {
+            // a CHS transfer can't cross a track boundary
+            count = min(count, disk->sectors - lba % disk->sectors);
+        }
+
+        // the BIOS can only write below 1 MiB, anything above goes through the bounce
+        // buffer which holds exactly one transfer, so each chunk is copied only once
+        uint32_t bytes = (uint32_t)count * DISK_SECTOR_SIZE;
+        bool bounce = (uint32_t)u8DataOut + bytes > MEMORY_REAL_MODE_LIMIT;
+        void* target = bounce ? MEMORY_DISK_BOUNCE_ADDR : u8DataOut;
+
+        if (disk->extensions)
+            ok = DISK_ReadSectorsLBA(disk, lba, count, target);
+        else
+            ok = DISK_ReadSectorsCHS(disk, lba, count, target);
+
+        if (!ok)
+            return false;
+
+        disk->readCalls++;
+        disk->sectorsRead += count;
+
+        if (bounce)
+            memcpy(u8DataOut, MEMORY_DISK_BOUNCE_ADDR, bytes);
+
+        lba += count;
+        sectors -= count;
+        u8DataOut += count * DISK_SECTOR_SIZE;
+    }
+
+    return true;
 }
\ No newline at end of file
@@ -4,12 +4,20 @@
 #include <stdbool.h>
 #include "x86.h"
 
+#define DISK_SECTOR_SIZE 512
+
 typedef struct {
     uint8_t id;
     uint16_t cylinders;
     uint16_t sectors;
     uint16_t heads;
+    bool     extensions;            // INT 13h extensions (AH=42h LBA reads) are usable
+    uint16_t bytesPerSector;
+    uint16_t maxTransferSectors;    // largest single BIOS transfer
+    uint32_t readCalls;             // BIOS transfers issued so far
+    uint32_t sectorsRead;
 } DISK;
 
 bool DISK_Initialize(DISK* disk, uint8_t driveNumber);
-bool DISK_ReadSectors(DISK* disk, uint32_t lba, uint8_t sectors, void * lowerDataOut);
\ No newline at end of file
+// 'dataOut' may point anywhere, reads above 1 MiB are staged through a bounce buffer
+bool DISK_ReadSectors(DISK* disk, uint32_t lba, uint16_t sectors, void * dataOut);
\ No newline at end of file
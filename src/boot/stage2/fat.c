@@ -8,7 +8,19 @@
 #define MAX_FILE_HANDLES 10
 #define ROOT_DIRECTORY_HANDLE -1
 
-#define FAT_CACHE_SIZE 5        // In sectors
+// The FAT cache holds FAT_CACHE_WINDOWS windows of FAT_CACHE_SIZE sectors each, windows
+// are aligned to their size. 6 sectors is a multiple of 3, so FAT12 entries never
+// straddle two windows.
+#define FAT_CACHE_SIZE 6        // In sectors
+#define FAT_CACHE_WINDOWS 4
+#define FAT_CACHE_EMPTY 0xFFFFFFFF
+#define FAT_CACHE_MAX_ENTRIES (FAT_CACHE_SIZE * SECTOR_SIZE * 2 / 3)     // FAT12 packs the most entries in a window
+#define FAT_NO_BUFFER_LBA 0xFFFFFFFF
+#define FAT_MAX_RUN_SECTORS 0xFFFF  // Partition_ReadSectors takes a 16-bit count
+#define FAT_MAX_EXTENTS 8           // Per handle, longer chains are mapped a window at a time
+#define FAT_PATH_CACHE_SIZE 16
+#define FAT_PATH_CACHE_EMPTY 0xFFFFFFFF
+#define FAT_ROOT_PARENT 0           // Parent key of root directory entries, cluster 0 is never a directory
 
 typedef struct{
     // extended boot record
@@ -62,17 +74,47 @@ struct FAT_BootSector
 typedef struct FAT_BootSector FAT_BootSector;
 
 
+// A run of physically contiguous clusters
+typedef struct{
+    uint32_t FirstCluster;
+    uint32_t Length;                    // In clusters
+} FAT_Extent;
+
 struct FAT_FileData{
     uint8_t  Buffer[SECTOR_SIZE];
     FAT_File Public;
     bool     Opened;
     uint32_t FirstCluster;
-    uint32_t CurrentCluster;
-    uint32_t CurrentSectorInCluster;
+    uint32_t BufferLba;                 // LBA of the sector held in Buffer, FAT_NO_BUFFER_LBA if none
+
+    FAT_Extent Extents[FAT_MAX_EXTENTS];
+    uint32_t   ExtentCount;
+    uint32_t   ExtentsStartIndex;       // Index (in clusters, from the start of the file) of Extents[0]
+    uint32_t   NextChainCluster;        // Cluster following the last mapped extent
 };
 
 typedef struct FAT_FileData FAT_FileData;
 
+// Windows are kept decoded, Next[i] is the cluster following the i-th cluster of the window
+typedef struct{
+    uint32_t Next[FAT_CACHE_MAX_ENTRIES];
+    uint32_t Window;                    // Window index (FAT sector / FAT_CACHE_SIZE), FAT_CACHE_EMPTY if unused
+    uint32_t LastUse;
+} FAT_CacheWindow;
+
+// Decodes one raw FAT window into a dense next-cluster array, end of chain markers
+// are sign extended to 0xFFFFFFF8 and above whatever the FAT type
+typedef struct{
+    uint32_t EntriesPerWindow;
+    void (*DecodeWindow)(const uint8_t* fat, uint32_t* nextOut);
+} FAT_Decoder;
+
+// A resolved path component: the entry named Entry.Name inside the directory starting at ParentCluster
+typedef struct{
+    uint32_t           ParentCluster;   // FAT_PATH_CACHE_EMPTY if unused
+    FAT_DirectoryEntry Entry;
+} FAT_PathCacheEntry;
+
 struct FAT_Data
 {
     union{
@@ -83,8 +125,14 @@ struct FAT_Data
     FAT_FileData RootDirectory;
     FAT_FileData OpenedFiles[MAX_FILE_HANDLES];
 
-    uint8_t  FatCache[FAT_CACHE_SIZE * SECTOR_SIZE];
-    uint32_t FatCachePosition;
+    uint8_t         FatCacheRaw[FAT_CACHE_SIZE * SECTOR_SIZE];
+    FAT_CacheWindow FatCache[FAT_CACHE_WINDOWS];
+    FAT_CacheWindow* FatCacheLast;
+    uint32_t        FatCacheClock;
+    FAT_CacheStats  FatCacheStats;
+
+    FAT_PathCacheEntry PathCache[FAT_PATH_CACHE_SIZE];
+    uint32_t           PathCacheNext;
 };
 
 typedef struct FAT_Data FAT_Data;
@@ -94,6 +142,13 @@ static uint32_t  g_DataSectionLBA;
 static uint8_t   g_FatType;
 static uint32_t  g_TotalSectors;
 static uint32_t  g_SectorsPerFat;
+static const FAT_Decoder* g_FatDecoder;
+
+static bool FAT_IsEndOfChain(uint32_t cluster)
+{
+    // free/reserved entries can only show up in a broken chain, stop there as well
+    return cluster >= 0xFFFFFFF8 || cluster < 2;
+}
 
 uint32_t FAT_ClusterToLba(uint32_t cluster)
 {
@@ -105,77 +160,192 @@ bool FAT_ReadBootSector(Partition* disk)
     return Partition_ReadSectors(disk, 0, 1, g_Data->BS.BootSectorBytes);
 }
 
-bool FAT_ReadFat(Partition* disk, size_t lbaIndex)
+bool FAT_ReadFat(Partition* disk, size_t lbaIndex, uint8_t* dataOut)
 {
     return Partition_ReadSectors(
         disk,
         g_Data->BS.BootSector.ReservedSectors + lbaIndex,
         FAT_CACHE_SIZE,
-        g_Data->FatCache
+        dataOut
     );
 }
 
+static void FAT12_DecodeWindow(const uint8_t* fat, uint32_t* nextOut)
+{
+    // two entries are packed in every 3 bytes
+    for (uint32_t i = 0; i < FAT_CACHE_SIZE * SECTOR_SIZE / 3; i++, fat += 3) {
+        uint32_t even = fat[0] | ((uint32_t)(fat[1] & 0x0F) << 8);
+        uint32_t odd  = (fat[1] >> 4) | ((uint32_t)fat[2] << 4);
+
+        *nextOut++ = even >= 0xFF8 ? even | 0xFFFFF000 : even;
+        *nextOut++ = odd  >= 0xFF8 ? odd  | 0xFFFFF000 : odd;
+    }
+}
+
+static void FAT16_DecodeWindow(const uint8_t* fat, uint32_t* nextOut)
+{
+    const uint16_t* entries = (const uint16_t*)fat;
+
+    for (uint32_t i = 0; i < FAT_CACHE_SIZE * SECTOR_SIZE / 2; i++) {
+        uint32_t next = entries[i];
+        nextOut[i] = next >= 0xFFF8 ? next | 0xFFFF0000 : next;
+    }
+}
+
+static void FAT32_DecodeWindow(const uint8_t* fat, uint32_t* nextOut)
+{
+    const uint32_t* entries = (const uint32_t*)fat;
+
+    for (uint32_t i = 0; i < FAT_CACHE_SIZE * SECTOR_SIZE / 4; i++) {
+        // the upper 4 bits of a FAT32 entry are reserved
+        uint32_t next = entries[i] & 0x0FFFFFFF;
+        nextOut[i] = next >= 0x0FFFFFF8 ? next | 0xF0000000 : next;
+    }
+}
+
+static const FAT_Decoder g_Fat12Decoder = {
+    .EntriesPerWindow = FAT_CACHE_SIZE * SECTOR_SIZE * 2 / 3,
+    .DecodeWindow = &FAT12_DecodeWindow,
+};
+
+static const FAT_Decoder g_Fat16Decoder = {
+    .EntriesPerWindow = FAT_CACHE_SIZE * SECTOR_SIZE / 2,
+    .DecodeWindow = &FAT16_DecodeWindow,
+};
+
+static const FAT_Decoder g_Fat32Decoder = {
+    .EntriesPerWindow = FAT_CACHE_SIZE * SECTOR_SIZE / 4,
+    .DecodeWindow = &FAT32_DecodeWindow,
+};
+
+// Returns the decoded contents of a FAT window, loading it over the least recently used
+// window on a miss. Prefetches don't count as hits or misses and don't refresh a window.
+static const uint32_t* FAT_CacheGetWindow(Partition* disk, uint32_t window, bool prefetch)
+{
+    // chain walks stay in the same window most of the time
+    if (!prefetch && g_Data->FatCacheLast != NULL && g_Data->FatCacheLast->Window == window) {
+        g_Data->FatCacheStats.Hits++;
+        g_Data->FatCacheLast->LastUse = ++g_Data->FatCacheClock;
+        return g_Data->FatCacheLast->Next;
+    }
+
+    FAT_CacheWindow* victim = &g_Data->FatCache[0];
+
+    for (int i = 0; i < FAT_CACHE_WINDOWS; i++) {
+        FAT_CacheWindow* entry = &g_Data->FatCache[i];
+
+        if (entry->Window == window) {
+            if (!prefetch) {
+                g_Data->FatCacheStats.Hits++;
+                entry->LastUse = ++g_Data->FatCacheClock;
+                g_Data->FatCacheLast = entry;
+            }
+            return entry->Next;
+        }
+
+        if (entry->LastUse < victim->LastUse)
+            victim = entry;
+    }
+
+    if (prefetch)
+        g_Data->FatCacheStats.Prefetches++;
+    else
+        g_Data->FatCacheStats.Misses++;
+
+    if (g_Data->FatCacheLast == victim)
+        g_Data->FatCacheLast = NULL;
+
+    if (!FAT_ReadFat(disk, window * FAT_CACHE_SIZE, g_Data->FatCacheRaw)) {
+        printf("[FAT] [FAT_CacheGetWindow] Read error!\r\n");
+        victim->Window = FAT_CACHE_EMPTY;
+        victim->LastUse = 0;
+        return NULL;
+    }
+
+    g_FatDecoder->DecodeWindow(g_Data->FatCacheRaw, victim->Next);
+    victim->Window = window;
+    victim->LastUse = ++g_Data->FatCacheClock;
+    if (!prefetch)
+        g_Data->FatCacheLast = victim;
+
+    return victim->Next;
+}
+
 void FAT_Detect(Partition* disk) {
     uint32_t dataCluster = (g_TotalSectors - g_DataSectionLBA) / g_Data->BS.BootSector.SectorsPerCluster;
     printf("datacluster=%x\r\n",dataCluster);
     if (dataCluster < 0xFF5) {
         g_FatType = FAT12;
+        g_FatDecoder = &g_Fat12Decoder;
     } else if (g_Data->BS.BootSector.SectorsPerFat != 0) {
         g_FatType = FAT16;
+        g_FatDecoder = &g_Fat16Decoder;
     } else{
         g_FatType = FAT32;
+        g_FatDecoder = &g_Fat32Decoder;
     }
 }
 
-uint32_t FAT_NextCluster(Partition* disk, uint32_t currentCluster){
+// Returns the decoded window holding the FAT entry of 'cluster' and the entry's index in it.
+static const uint32_t* FAT_LookupEntry(Partition* disk, uint32_t cluster, uint32_t* entryOut){
+    uint32_t entriesPerWindow = g_FatDecoder->EntriesPerWindow;
+    uint32_t window = cluster / entriesPerWindow;
+    uint32_t entry = cluster % entriesPerWindow;
 
-    // Determine the offset of the entry to read.
-    uint32_t fatIndex;
-    if (g_FatType == FAT12) {
-        fatIndex = currentCluster * 3 / 2;
-    } else if(g_FatType == FAT16) {
-        fatIndex = currentCluster * 2;
-    } else /* if (g_FatType == 32)*/ {
-        fatIndex = currentCluster * 4;
-    }
-
-    // Check if cache has correct number
+    const uint32_t* next = FAT_CacheGetWindow(disk, window, false);
+    if (next == NULL)
+        return NULL;
 
-    uint32_t fatIndexSector = fatIndex / SECTOR_SIZE;
-
-    if( fatIndexSector < g_Data->FatCachePosition
-        || fatIndexSector >= g_Data->FatCachePosition + FAT_CACHE_SIZE
+    // the walk is about to leave this window (last sector's worth of entries), bring in the next one
+    if (entry >= entriesPerWindow - entriesPerWindow / FAT_CACHE_SIZE
+        && (window + 1) * FAT_CACHE_SIZE < g_SectorsPerFat
     ){
-        FAT_ReadFat(disk,fatIndexSector);
-        g_Data->FatCachePosition = fatIndexSector;
+        FAT_CacheGetWindow(disk, window + 1, true);
     }
 
-    fatIndex -= (g_Data->FatCachePosition * SECTOR_SIZE);
+    *entryOut = entry;
+    return next;
+}
 
-    uint32_t nextCluster;
-    if (g_FatType == FAT12) {
-        if(currentCluster % 2 == 0){
-            nextCluster = (*(uint16_t *)(g_Data->FatCache + fatIndex)) & 0x0FFF;
-        }else {
-            nextCluster = (*(uint16_t *)(g_Data->FatCache + fatIndex)) >> 4;
-        }
+uint32_t FAT_NextCluster(Partition* disk, uint32_t currentCluster){
+    uint32_t entry;
+    const uint32_t* next = FAT_LookupEntry(disk, currentCluster, &entry);
+    if (next == NULL)
+        return 0xFFFFFFFF;
 
-        if (nextCluster >= 0xFF8) {
-            nextCluster |= 0xFFFFF000;
+    return next[entry];
+}
+
+// Follows the chain from 'cluster' for as long as it stays physically contiguous, straight
+// from the decoded windows. Returns the length of the run (in clusters) and stores the
+// cluster that comes after it in 'nextOut'.
+static uint32_t FAT_FollowRun(Partition* disk, uint32_t cluster, uint32_t* nextOut){
+    uint32_t length = 1;
+
+    for(;;){
+        uint32_t entry;
+        const uint32_t* next = FAT_LookupEntry(disk, cluster, &entry);
+        if (next == NULL){
+            *nextOut = 0xFFFFFFFF;
+            return length;
         }
 
-    } else if(g_FatType == FAT16) {
-        nextCluster = *(uint16_t *)(g_Data->FatCache + fatIndex);
+        uint32_t last = g_FatDecoder->EntriesPerWindow - 1;
+        while (entry < last && next[entry] == cluster + 1){
+            cluster++;
+            entry++;
+            length++;
+        }
 
-        if (nextCluster >= 0xFFF8) {
-            nextCluster |= 0xFFFF0000;
+        if (next[entry] != cluster + 1){
+            *nextOut = next[entry];
+            return length;
         }
 
-    } else /*if (g_FatType == 32)*/ {
-        nextCluster = *(uint32_t *)(g_Data->FatCache + fatIndex);
+        // the run continues in the next window
+        cluster++;
+        length++;
     }
-
-    return nextCluster;
 }
 
 bool FAT_Initialize(Partition* disk) {
@@ -189,7 +359,16 @@ bool FAT_Initialize(Partition* disk) {
         return false;
     }
     
-    g_Data->FatCachePosition = 0xFFFFFFFF;
+    for (int i = 0; i < FAT_CACHE_WINDOWS; i++) {
+        g_Data->FatCache[i].Window = FAT_CACHE_EMPTY;
+        g_Data->FatCache[i].LastUse = 0;
+    }
+    g_Data->FatCacheLast = NULL;
+    g_Data->FatCacheClock = 0;
+    memset(&g_Data->FatCacheStats, 0, sizeof(g_Data->FatCacheStats));
+    for (int i = 0; i < FAT_PATH_CACHE_SIZE; i++)
+        g_Data->PathCache[i].ParentCluster = FAT_PATH_CACHE_EMPTY;
+    g_Data->PathCacheNext = 0;
 
     g_TotalSectors = g_Data->BS.BootSector.TotalSectors;
 
@@ -228,8 +407,7 @@ bool FAT_Initialize(Partition* disk) {
     g_Data->RootDirectory.Public.Size =  sizeof(FAT_DirectoryEntry) * g_Data->BS.BootSector.DirEntryCount;
     g_Data->RootDirectory.Opened = true;
     g_Data->RootDirectory.FirstCluster = rootDirLBA;
-    g_Data->RootDirectory.CurrentCluster = rootDirLBA;
-    g_Data->RootDirectory.CurrentSectorInCluster = 0;
+    g_Data->RootDirectory.BufferLba = rootDirLBA;
 
 
     if (!Partition_ReadSectors(disk, rootDirLBA, 1, g_Data->RootDirectory.Buffer)){
@@ -246,6 +424,21 @@ bool FAT_Initialize(Partition* disk) {
     return true;
 }
 
+// Walks the cluster chain from 'cluster' and records it as runs of contiguous clusters,
+// 'index' is the position of 'cluster' in the file (in clusters).
+static void FAT_MapExtents(Partition* disk, FAT_FileData* fd, uint32_t index, uint32_t cluster){
+    fd->ExtentsStartIndex = index;
+    fd->ExtentCount = 0;
+
+    while(!FAT_IsEndOfChain(cluster) && fd->ExtentCount < FAT_MAX_EXTENTS){
+        FAT_Extent* extent = &fd->Extents[fd->ExtentCount++];
+        extent->FirstCluster = cluster;
+        extent->Length = FAT_FollowRun(disk, cluster, &cluster);
+    }
+
+    fd->NextChainCluster = cluster;
+}
+
 FAT_File* FAT_OpenEntry(Partition* disk, FAT_DirectoryEntry* entry){
     int handle = -1;
 
@@ -265,13 +458,12 @@ FAT_File* FAT_OpenEntry(Partition* disk, FAT_DirectoryEntry* entry){
     fd->Public.Position = 0;
     fd->Public.Size = entry->Size;
     fd->FirstCluster = entry->FirstClusterLow + ((uint32_t)entry->FirstClusterHigh << 16);
-    fd->CurrentCluster = fd->FirstCluster;
-    fd->CurrentSectorInCluster = 0;
 
-    if(!Partition_ReadSectors(disk, FAT_ClusterToLba(fd->CurrentCluster), 1, fd->Buffer)){
-        printf("[FAT] [FAT_OpenEntry] Read error!\r\n");
-        return false;
-    }
+    // walk the cluster chain once, reads and seeks then only look at the extents
+    FAT_MapExtents(disk, fd, 0, fd->FirstCluster);
+
+    // the first sector is fetched by FAT_Read, possibly as part of a larger run
+    fd->BufferLba = FAT_NO_BUFFER_LBA;
 
     fd->Opened = true;
     return &fd->Public;
@@ -279,6 +471,63 @@ FAT_File* FAT_OpenEntry(Partition* disk, FAT_DirectoryEntry* entry){
 
 
 
+// Maps the sector containing 'position' to an LBA. Returns how many sectors are
+// physically contiguous from there, or 0 if 'position' is past the end of the chain.
+static uint32_t FAT_MapPosition(Partition* disk, FAT_FileData* fd, uint32_t position, uint32_t* lbaOut){
+    uint32_t sector = position / SECTOR_SIZE;
+
+    // the FAT12/16 root directory is a plain run of sectors
+    if(fd->Public.Handle == ROOT_DIRECTORY_HANDLE){
+        *lbaOut = fd->FirstCluster + sector;
+        return FAT_MAX_RUN_SECTORS;
+    }
+
+    uint32_t sectorsPerCluster = g_Data->BS.BootSector.SectorsPerCluster;
+    uint32_t cluster = sector / sectorsPerCluster;
+    uint32_t sectorInCluster = sector % sectorsPerCluster;
+
+    // seeking back past the mapped window, start over from the first cluster
+    if(cluster < fd->ExtentsStartIndex)
+        FAT_MapExtents(disk, fd, 0, fd->FirstCluster);
+
+    for(;;){
+        uint32_t index = fd->ExtentsStartIndex;
+
+        for(uint32_t i = 0; i < fd->ExtentCount; i++){
+            FAT_Extent* extent = &fd->Extents[i];
+
+            if(cluster < index + extent->Length){
+                uint32_t clusterInExtent = cluster - index;
+                *lbaOut = FAT_ClusterToLba(extent->FirstCluster + clusterInExtent) + sectorInCluster;
+                return (extent->Length - clusterInExtent) * sectorsPerCluster - sectorInCluster;
+            }
+
+            index += extent->Length;
+        }
+
+        if(FAT_IsEndOfChain(fd->NextChainCluster))
+            return 0;
+
+        // past the mapped window, map the next part of the chain
+        FAT_MapExtents(disk, fd, index, fd->NextChainCluster);
+    }
+}
+
+// Makes sure the handle's sector buffer holds 'lba'
+static bool FAT_LoadBuffer(Partition* disk, FAT_FileData* fd, uint32_t lba){
+    if(fd->BufferLba == lba)
+        return true;
+
+    if(!Partition_ReadSectors(disk, lba, 1, fd->Buffer)){
+        fd->BufferLba = FAT_NO_BUFFER_LBA;
+        printf("[FAT] [FAT_LoadBuffer] Read error!\r\n");
+        return false;
+    }
+
+    fd->BufferLba = lba;
+    return true;
+}
+
 uint32_t FAT_Read(Partition* disk, FAT_File * file, uint32_t byteCount, void* dataOut){
     FAT_FileData * fd = (file->Handle == ROOT_DIRECTORY_HANDLE)
                                 ? &g_Data->RootDirectory
@@ -291,42 +540,53 @@ uint32_t FAT_Read(Partition* disk, FAT_File * file, uint32_t byteCount, void* da
         byteCount = min(byteCount, fd->Public.Size - fd->Public.Position);
 
     while(byteCount > 0){
-        uint32_t leftInBuffer = SECTOR_SIZE - (fd->Public.Position % SECTOR_SIZE);
-        uint32_t take = min(byteCount,leftInBuffer);
+        uint32_t lba;
+        uint32_t contiguous = FAT_MapPosition(disk, fd, fd->Public.Position, &lba);
+        if(contiguous == 0){
+            fd->Public.Size = fd->Public.Position;
+            break;
+        }
+
+        uint32_t offsetInSector = fd->Public.Position % SECTOR_SIZE;
+        uint32_t take;
+
+        if(offsetInSector == 0 && byteCount >= SECTOR_SIZE){
+            // aligned: whole sectors of the extent go straight into the caller's buffer
+            uint32_t sectors = min(byteCount / SECTOR_SIZE, contiguous);
+            sectors = min(sectors, FAT_MAX_RUN_SECTORS);
+
+            if(!Partition_ReadSectors(disk, lba, sectors, u8dataOut)){
+                printf("[FAT] [FAT_Read] Read error!\r\n");
+                break;
+            }
+
+            take = sectors * SECTOR_SIZE;
+        } else {
+            // unaligned head or tail: go through the per-handle sector buffer
+            if(!FAT_LoadBuffer(disk, fd, lba))
+                break;
+
+            take = min(byteCount, SECTOR_SIZE - offsetInSector);
+            memcpy(u8dataOut, fd->Buffer + offsetInSector, take);
+        }
 
-        memcpy(u8dataOut, fd->Buffer + fd->Public.Position % SECTOR_SIZE, take);
         u8dataOut += take;
         fd->Public.Position += take;
         byteCount -= take;
-        if(leftInBuffer == take){
-            if(fd->Public.Handle == ROOT_DIRECTORY_HANDLE){
-                ++fd->CurrentCluster;
-                if(!Partition_ReadSectors(disk, fd->CurrentCluster, 1, fd->Buffer)){
-                    printf("[FAT] [FAT_Read] Read error!\r\n");
-                    break;
-                }
-            } else {
-                if(++fd->CurrentSectorInCluster >= g_Data->BS.BootSector.SectorsPerCluster){
-                    fd->CurrentSectorInCluster = 0;
-                    fd->CurrentCluster = FAT_NextCluster(disk, fd->CurrentCluster);
-                }
-
-                if(fd->CurrentCluster >= 0xFFFFFFF8){
-                    fd->Public.Size = fd->Public.Position;
-                    break;
-                }
-
-                if(!Partition_ReadSectors(disk, FAT_ClusterToLba(fd->CurrentCluster) + fd->CurrentSectorInCluster, 1, fd->Buffer)){
-                    printf("[FAT] [FAT_Read] Read error!\r\n");
-                    break;
-                }
-            }
-        }
     }
 
     return u8dataOut - (uint8_t*) dataOut;
 }
 
+void FAT_Seek(FAT_File * file, uint32_t position){
+    // directories without a size are bounded by their cluster chain instead
+    if (!file->IsDirectory || file->Size != 0)
+        position = min(position, file->Size);
+
+    // the extent lookup happens lazily on the next read
+    file->Position = position;
+}
+
 bool FAT_ReadEntry(Partition* disk, FAT_File * file, FAT_DirectoryEntry* dirEntry){
     return FAT_Read(disk,file,sizeof(FAT_DirectoryEntry),dirEntry) == sizeof(FAT_DirectoryEntry);
 }
@@ -334,20 +594,21 @@ bool FAT_ReadEntry(Partition* disk, FAT_File * file, FAT_DirectoryEntry* dirEntr
 void FAT_Close(FAT_File * file){
     if (file->Handle == ROOT_DIRECTORY_HANDLE){
         file->Position = 0;
-        g_Data->RootDirectory.CurrentCluster = g_Data->RootDirectory.FirstCluster;
     }else{
         g_Data->OpenedFiles[file->Handle].Opened = false;
     }
 }
 
-bool FAT_FindFile(Partition* disk, FAT_File * file, const char* name, FAT_DirectoryEntry* entryOut)
+static void FAT_ToFatName(const char* name, uint8_t fatName[11])
 {
-    char fatName[12];
-    FAT_DirectoryEntry entry;
+    memset(fatName, ' ', 11);
 
-    // convert from name to fat name
-    memset(fatName, ' ', sizeof(fatName));
-    fatName[11] = '\0';
+    // '.' and '..' are stored as they are
+    if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+    {
+        memcpy(fatName, name, strlen(name));
+        return;
+    }
 
     const char* ext = strchr(name, '.');
     if (ext == NULL)
@@ -361,14 +622,56 @@ bool FAT_FindFile(Partition* disk, FAT_File * file, const char* name, FAT_Direct
         for (int i = 0; i < 3 && ext[i + 1]; i++)
             fatName[i + 8] = toUpper(ext[i + 1]);
     }
+}
+
+static bool FAT_NameEquals(const uint8_t* a, const uint8_t* b)
+{
+    // 11 bytes: two dwords, a word and a byte
+    return *(const uint32_t*)a == *(const uint32_t*)b
+        && *(const uint32_t*)(a + 4) == *(const uint32_t*)(b + 4)
+        && *(const uint16_t*)(a + 8) == *(const uint16_t*)(b + 8)
+        && a[10] == b[10];
+}
+
+// Scans the directory in place, one sector at a time in the handle's buffer.
+bool FAT_FindFile(Partition* disk, FAT_File * file, const uint8_t* fatName, FAT_DirectoryEntry* entryOut)
+{
+    FAT_FileData * fd = (file->Handle == ROOT_DIRECTORY_HANDLE)
+                                ? &g_Data->RootDirectory
+                                : &g_Data->OpenedFiles[file->Handle];
+
+    for (uint32_t position = 0; file->Size == 0 || position < file->Size; position += SECTOR_SIZE)
+    {
+        uint32_t lba;
+        if (FAT_MapPosition(disk, fd, position, &lba) == 0 || !FAT_LoadBuffer(disk, fd, lba))
+            return false;
+
+        const FAT_DirectoryEntry* entries = (const FAT_DirectoryEntry*)fd->Buffer;
+        for (int i = 0; i < SECTOR_SIZE / sizeof(FAT_DirectoryEntry); i++)
+        {
+            // a name starting with 0 marks the end of the directory
+            if (entries[i].Name[0] == 0)
+                return false;
+
+            if (FAT_NameEquals(entries[i].Name, fatName))
+            {
+                *entryOut = entries[i];
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
 
-    while (FAT_ReadEntry(disk, file, &entry))
+static bool FAT_PathCacheLookup(uint32_t parentCluster, const uint8_t* fatName, FAT_DirectoryEntry* entryOut)
+{
+    for (int i = 0; i < FAT_PATH_CACHE_SIZE; i++)
     {
-        // printf("FAT name: %s\r\n", fatName);
-        // printf("Entry name: %s\r\n", entry.Name);
-        if (memcmp(fatName, entry.Name, 11) == 0)
+        FAT_PathCacheEntry* cached = &g_Data->PathCache[i];
+        if (cached->ParentCluster == parentCluster && FAT_NameEquals(cached->Entry.Name, fatName))
         {
-            *entryOut = entry;
+            *entryOut = cached->Entry;
             return true;
         }
     }
@@ -376,15 +679,28 @@ bool FAT_FindFile(Partition* disk, FAT_File * file, const char* name, FAT_Direct
     return false;
 }
 
+static void FAT_PathCacheInsert(uint32_t parentCluster, const FAT_DirectoryEntry* entry)
+{
+    FAT_PathCacheEntry* cached = &g_Data->PathCache[g_Data->PathCacheNext];
+    g_Data->PathCacheNext = (g_Data->PathCacheNext + 1) % FAT_PATH_CACHE_SIZE;
+
+    cached->ParentCluster = parentCluster;
+    cached->Entry = *entry;
+}
+
 
 FAT_File * FAT_Open(Partition* disk, const char* path){
     char name[MAX_PATH_SIZE];
+    uint8_t fatName[11];
 
     // ignore leading slash
     if (path[0] == '/')
         path++;
 
-    FAT_File* current = &g_Data->RootDirectory.Public;
+    // directories are only opened when a component isn't in the path cache
+    FAT_DirectoryEntry entry;
+    bool isRoot = true;
+    uint32_t parentCluster = FAT_ROOT_PARENT;
 
     while (*path) {
         // extract next file name from path
@@ -400,39 +716,54 @@ FAT_File * FAT_Open(Partition* disk, const char* path){
         {
             unsigned len = strlen(path);
             memcpy(name, path, len);
-            name[len + 1] = '\0';
+            name[len] = '\0';
             path += len;
             isLast = true;
         }
 
         printf("Searching for: %s\r\n", name);
 
-        // find directory entry in current directory
-        FAT_DirectoryEntry entry;
-        if (FAT_FindFile(disk, current, name, &entry))
-        {
+        FAT_ToFatName(name, fatName);
 
+        if (!FAT_PathCacheLookup(parentCluster, fatName, &entry))
+        {
+            // find directory entry in current directory
+            FAT_File* current = isRoot ? &g_Data->RootDirectory.Public : FAT_OpenEntry(disk, &entry);
+            if (current == NULL)
+                return NULL;
 
+            bool found = FAT_FindFile(disk, current, fatName, &entry);
             FAT_Close(current);
 
-            // check if directory
-            if (!isLast && entry.Attributes & FAT_ATTRIBUTE_DIRECTORY == 0)
+            if (!found)
             {
-                printf("FAT: %s not a directory\r\n", name);
+                printf("FAT: %s not found\r\n", name);
                 return NULL;
             }
 
-            // open new directory entry
-            current = FAT_OpenEntry(disk, &entry);
+            FAT_PathCacheInsert(parentCluster, &entry);
         }
-        else
-        {
-            FAT_Close(current);
 
-            printf("FAT: %s not found\r\n", name);
+        // check if directory
+        if (!isLast && (entry.Attributes & FAT_ATTRIBUTE_DIRECTORY) == 0)
+        {
+            printf("FAT: %s not a directory\r\n", name);
             return NULL;
         }
+
+        parentCluster = entry.FirstClusterLow + ((uint32_t)entry.FirstClusterHigh << 16);
+
+        // '..' entries pointing at the root directory use cluster 0
+        isRoot = (entry.Attributes & FAT_ATTRIBUTE_DIRECTORY) != 0 && parentCluster == FAT_ROOT_PARENT;
     }
 
-    return current;
+    if (isRoot)
+        return &g_Data->RootDirectory.Public;
+
+    // open new directory entry
+    return FAT_OpenEntry(disk, &entry);
+}
+
+void FAT_GetCacheStats(FAT_CacheStats* statsOut){
+    *statsOut = g_Data->FatCacheStats;
 }
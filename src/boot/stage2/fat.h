@@ -4,7 +4,7 @@
 #include <stddef.h>
 #include <stdbool.h>
 
-#include "string.h"
+#include <libk/string.h>
 
 #include "mbr.h"
 
@@ -31,6 +31,13 @@ typedef struct
     uint32_t Size;
 }__attribute__((packed)) FAT_DirectoryEntry;
 
+typedef struct
+{
+    uint32_t Hits;
+    uint32_t Misses;
+    uint32_t Prefetches;
+} FAT_CacheStats;
+
 typedef struct
 {
     int Handle;
@@ -61,4 +68,6 @@ bool FAT_Initialize(Partition* disk);
 FAT_File * FAT_Open(Partition* disk, const char* path);
 uint32_t FAT_Read(Partition* disk, FAT_File * file, uint32_t byteCount, void* dataOut);
 bool FAT_ReadEntry(Partition* disk, FAT_File * file, FAT_DirectoryEntry* dirEntry);
+void FAT_Seek(FAT_File * file, uint32_t position);
 void FAT_Close(FAT_File * file);
+void FAT_GetCacheStats(FAT_CacheStats* statsOut);
@@ -3,20 +3,41 @@
 #include "disk.h"
 #include "fat.h"
 #include "mbr.h"
+#include "x86.h"
+#include "memdetect.h"
+#include <boot/bootinfo.h>
 
-uint8_t* KernelLoadBuffer = (uint8_t*)MEMORY_LOAD_KERNEL;
 uint8_t* Kernel = (uint8_t*)MEMORY_KERNEL_ADDR;
 
-typedef void (*KernelStart)();
+BootInfo g_BootInfo;
+
+typedef void (*KernelStart)(BootInfo* bootInfo);
+
+static void Checkpoint(BootPhase phase, DISK* disk){
+    BootCheckpoint* checkpoint = &g_BootInfo.Checkpoints[phase];
+    checkpoint->Tsc = x86_rdtsc();
+    checkpoint->DiskCalls = disk != NULL ? disk->readCalls : 0;
+    checkpoint->DiskSectors = disk != NULL ? disk->sectorsRead : 0;
+}
 
 void __attribute__((cdecl)) start(uint16_t bootDrive,void* partition){
+    g_BootInfo.Magic = BOOT_INFO_MAGIC;
+    g_BootInfo.BootDrive = bootDrive;
+    g_BootInfo.Checkpoints[BOOT_PHASE_STAGE1_ENTRY].Tsc = *BOOT_STAGE1_TSC_ADDR;
+    Checkpoint(BOOT_PHASE_STAGE2_ENTRY, NULL);
+
     clrscr();
     printf("Loaded stage2 !!!\r\n");
+
+    if(Memory_Detect(&g_BootInfo) == 0)
+        printf("[BOOT] E820 memory map unavailable!\r\n");
+    Checkpoint(BOOT_PHASE_MEMORY_DETECT, NULL);
     DISK disk;
     if(!DISK_Initialize(&disk, bootDrive)){
         printf("[BOOT] Disk init error!\r\n");
         goto end;
     }
+    Checkpoint(BOOT_PHASE_DISK_INIT, &disk);
 
     printf("[BOOT] Main partiton addr. : 0x%x\n\r", partition);
     Partition part;
@@ -26,20 +47,30 @@ void __attribute__((cdecl)) start(uint16_t bootDrive,void* partition){
         printf("[BOOT] FAT init error!\r\n");
         goto end;
     }
+    Checkpoint(BOOT_PHASE_FAT_INIT, &disk);
 
-    //Load kernel
+    //Load kernel, straight to its final address (the disk layer bounces what the BIOS can't reach)
     FAT_File * fd = FAT_Open(&part, "/boot/kernel.bin");
-    uint32_t read;
-    uint8_t* KernelBuffer = Kernel;
-    while((read = FAT_Read(&part, fd, MEMORY_LOAD_SIZE, KernelLoadBuffer))){
-        memcpy(KernelBuffer, KernelLoadBuffer, read);
-        KernelBuffer += read;
+    if(fd == NULL){
+        printf("[BOOT] Kernel not found!\r\n");
+        goto end;
+    }
+
+    uint32_t read = FAT_Read(&part, fd, fd->Size, Kernel);
+    if(read != fd->Size){
+        printf("[BOOT] Kernel read error!\r\n");
+        goto end;
     }
     FAT_Close(fd);
+    Checkpoint(BOOT_PHASE_KERNEL_LOAD, &disk);
+
+    FAT_CacheStats fatStats;
+    FAT_GetCacheStats(&fatStats);
+    printf("[BOOT] FAT cache: %d hits, %d misses, %d prefetches\r\n", fatStats.Hits, fatStats.Misses, fatStats.Prefetches);
 
     //Kernel start
     KernelStart kernelstart = (KernelStart)Kernel;
-    kernelstart();
+    kernelstart(&g_BootInfo);
 
     end:
         for(;;);
@@ -22,6 +22,6 @@ void MBR_DetectPartition(Partition* part, DISK* disk, void* partition){
     }
 }
 
-bool Partition_ReadSectors(Partition* part, uint32_t lba, uint8_t sectors, void * lowerDataOut){
-    return DISK_ReadSectors(part->disk,lba + part->Offset, sectors, lowerDataOut);
+bool Partition_ReadSectors(Partition* part, uint32_t lba, uint16_t sectors, void * dataOut){
+    return DISK_ReadSectors(part->disk,lba + part->Offset, sectors, dataOut);
 }
@@ -12,4 +12,4 @@ typedef struct{
 }Partition;
 
 void MBR_DetectPartition(Partition* part, DISK* disk, void* partition);
-bool Partition_ReadSectors(Partition* part, uint32_t lba, uint8_t sectors, void * lowerDataOut);
\ No newline at end of file
+bool Partition_ReadSectors(Partition* part, uint32_t lba, uint16_t sectors, void * dataOut);
\ No newline at end of file
@@ -10,8 +10,9 @@
 #define MEMORY_FAT_ADDR  ((void *) 0x20000)
 #define MEMORY_FAT_SIZE 0x00010000
 
-#define MEMORY_LOAD_KERNEL ((void*) 0x30000)
-#define MEMORY_LOAD_SIZE 0x00010000
+// Disk bounce buffer - BIOS transfers targeting memory above 1 MiB are staged here
+#define MEMORY_DISK_BOUNCE_ADDR ((void*) 0x30000)
+#define MEMORY_DISK_BOUNCE_SIZE 0x00010000
 
 // 0x00020000 - 0x00030000 - stage 2
 
@@ -21,4 +22,7 @@
 // 0x000A0000 - 0x000C7FFF - Video
 // 0x000C8000 - 0x000FFFFF - BIOS
 
+// Everything below this address can be reached by the BIOS through a segment:offset pair
+#define MEMORY_REAL_MODE_LIMIT 0x00100000
+
 #define MEMORY_KERNEL_ADDR ((void*) 0x100000)
\ No newline at end of file
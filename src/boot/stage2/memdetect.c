@@ -0,0 +1,32 @@
+#include "memdetect.h"
+#include "x86.h"
+#include "stdio.h"
+
+uint32_t Memory_Detect(BootInfo* bootInfo){
+    E820MemoryBlock block;
+    uint32_t continuation = 0;
+    uint32_t count = 0;
+
+    int ret = x86_E820GetNextBlock(&block, &continuation);
+    while(ret > 0 && count < BOOT_MAX_MEMORY_REGIONS){
+        // skip empty entries and the ones the BIOS asks us to ignore (bit 0 of the extended attributes)
+        if(block.Length != 0 && (block.ACPI & 1)){
+            MemoryRegion* region = &bootInfo->MemoryRegions[count++];
+            region->Begin = block.Base;
+            region->Length = block.Length;
+            region->Type = block.Type;
+            region->ACPI = block.ACPI;
+        }
+
+        if(continuation == 0)
+            break;
+
+        ret = x86_E820GetNextBlock(&block, &continuation);
+    }
+
+    if(count == BOOT_MAX_MEMORY_REGIONS && continuation != 0)
+        printf("[BOOT] Memory map truncated to %d regions\r\n", count);
+
+    bootInfo->MemoryRegionCount = count;
+    return count;
+}
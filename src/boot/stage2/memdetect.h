@@ -0,0 +1,5 @@
+#pragma once
+#include <boot/bootinfo.h>
+
+// Fills the memory map of the boot info from the BIOS, returns the number of regions found
+uint32_t Memory_Detect(BootInfo* bootInfo);
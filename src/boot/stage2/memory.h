@@ -1,8 +1,5 @@
 #pragma once
 #include <stdint.h>
-
-void * memcpy( void * dst, const void * src, uint16_t num);
-void * memset(void * ptr, int value, uint16_t num);
-int memcmp(const void * ptr1, const void * ptr2, uint16_t num);
+#include <libk/memory.h>
 
 void* segmentoffset_to_linear(void* address);
\ No newline at end of file
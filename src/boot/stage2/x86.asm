@@ -78,6 +78,14 @@ x86_inb:
     in al, dx
     ret
 
+; uint64_t _cdecl x86_rdtsc();
+
+global x86_rdtsc
+x86_rdtsc:
+    [bits 32]
+    rdtsc               ; result in edx:eax, as cdecl expects it
+    ret
+
 
 ; bool _cdecl x86_Disk_GetDriveParams(uint8_t drive, uint8_t* driveTypeOut, uint16_t* cylindersOut, uint16_t* sectorsOut, uint16_t* headsOut);
 
@@ -246,3 +254,212 @@ x86_Disk_Read:
     mov esp, ebp
     pop ebp
     ret
+
+; bool _cdecl x86_Disk_CheckExtensions(uint8_t drive);
+
+global x86_Disk_CheckExtensions
+x86_Disk_CheckExtensions:
+    [bits 32]
+
+    push ebp
+    mov ebp, esp
+
+    x86_EnterRealMode
+
+    [bits 16]
+
+    push ebx
+    push ecx
+    push edx
+
+    mov ah, 41h
+    mov bx, 55AAh
+    mov dl, [bp + 8]
+    stc
+    int 13h
+
+    ; success only if the signature is swapped and the
+    ; fixed disk access subset (AH=42h-44h,47h,48h) is present
+    mov eax, 0
+    jc .done
+    cmp bx, 0AA55h
+    jne .done
+    test cx, 1
+    jz .done
+    mov eax, 1
+
+.done:
+    pop edx
+    pop ecx
+    pop ebx
+
+    push eax
+
+    x86_EnterProtectedMode
+
+    [bits 32]
+
+    pop eax
+
+    mov esp, ebp
+    pop ebp
+    ret
+
+
+; bool _cdecl x86_Disk_GetExtendedDriveParams(uint8_t drive, EDD_DriveParameters* paramsOut);
+
+global x86_Disk_GetExtendedDriveParams
+x86_Disk_GetExtendedDriveParams:
+    [bits 32]
+
+    push ebp
+    mov ebp, esp
+
+    x86_EnterRealMode
+
+    [bits 16]
+
+    push ds
+    push esi
+
+    mov dl, [bp + 8]
+
+    ; ds:si - result buffer
+    LinearToSegOffset [bp + 12], ds, esi, si
+
+    mov ah, 48h
+    stc
+    int 13h
+
+    mov eax, 1
+    sbb eax, 0
+
+    pop esi
+    pop ds
+
+    push eax
+
+    x86_EnterProtectedMode
+
+    [bits 32]
+
+    pop eax
+
+    mov esp, ebp
+    pop ebp
+    ret
+
+
+; bool _cdecl x86_Disk_ExtendedRead(uint8_t drive, EDD_DiskAddressPacket* packet);
+
+global x86_Disk_ExtendedRead
+x86_Disk_ExtendedRead:
+    [bits 32]
+
+    push ebp
+    mov ebp, esp
+
+    x86_EnterRealMode
+
+    [bits 16]
+
+    push ds
+    push esi
+
+    mov dl, [bp + 8]
+
+    ; ds:si - disk address packet
+    LinearToSegOffset [bp + 12], ds, esi, si
+
+    mov ah, 42h
+    stc
+    int 13h
+
+    mov eax, 1
+    sbb eax, 0
+
+    pop esi
+    pop ds
+
+    push eax
+
+    x86_EnterProtectedMode
+
+    [bits 32]
+
+    pop eax
+
+    mov esp, ebp
+    pop ebp
+    ret
+
+
+; int _cdecl x86_E820GetNextBlock(E820MemoryBlock* block, uint32_t* continuationId);
+
+E820Signature   equ 0x534D4150      ; 'SMAP'
+
+global x86_E820GetNextBlock
+x86_E820GetNextBlock:
+    [bits 32]
+
+    push ebp
+    mov ebp, esp
+
+    x86_EnterRealMode
+
+    [bits 16]
+
+    push ebx
+    push ecx
+    push edx
+    push esi
+    push edi
+    push ds
+    push es
+
+    ; ds:si - continuation id
+    LinearToSegOffset [bp + 12], ds, esi, si
+    mov ebx, [ds:si]
+
+    ; es:di - destination block
+    LinearToSegOffset [bp + 8], es, edi, di
+
+    ; BIOSes that only return 20 bytes leave the extended attributes alone, mark them valid up front
+    mov dword [es:di + 20], 1
+
+    mov eax, 0E820h
+    mov edx, E820Signature
+    mov ecx, 24
+    int 15h
+
+    jc .error
+    cmp eax, E820Signature
+    jne .error
+
+    mov eax, ecx
+    mov [ds:si], ebx
+    jmp .done
+
+.error:
+    mov eax, -1
+
+.done:
+    pop es
+    pop ds
+    pop edi
+    pop esi
+    pop edx
+    pop ecx
+    pop ebx
+
+    push eax
+
+    x86_EnterProtectedMode
+
+    [bits 32]
+
+    pop eax
+
+    mov esp, ebp
+    pop ebp
+    ret
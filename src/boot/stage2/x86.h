@@ -4,8 +4,47 @@
 
 void __attribute__((cdecl)) x86_outb(uint16_t port, uint8_t value);
 uint8_t __attribute__((cdecl)) x86_inb(uint16_t port);
+uint64_t __attribute__((cdecl)) x86_rdtsc();
 
 bool  __attribute__((cdecl)) x86_Disk_GetDriveParams(uint8_t drive, uint8_t* driveTypeOut, uint16_t* cylindersOut, uint16_t* sectorsOut, uint16_t* headsOut);
 bool __attribute__((cdecl))  x86_Disk_Reset(uint8_t drive);
 
-bool __attribute__((cdecl)) x86_Disk_Read(uint8_t drive, uint16_t cylinder, uint16_t head, uint16_t sector, uint8_t count, uint8_t * dataOut);
\ No newline at end of file
+bool __attribute__((cdecl)) x86_Disk_Read(uint8_t drive, uint16_t cylinder, uint16_t head, uint16_t sector, uint8_t count, uint8_t * dataOut);
+
+// EDD disk address packet, used by the INT 13h AH=42h extended read
+typedef struct {
+    uint8_t  Size;
+    uint8_t  _Reserved;
+    uint16_t Count;
+    uint16_t Offset;
+    uint16_t Segment;
+    uint64_t Lba;
+} __attribute__((packed)) EDD_DiskAddressPacket;
+
+// EDD drive parameters, filled in by INT 13h AH=48h ('Size' must be set by the caller)
+typedef struct {
+    uint16_t Size;
+    uint16_t Flags;
+    uint32_t Cylinders;
+    uint32_t Heads;
+    uint32_t SectorsPerTrack;
+    uint64_t TotalSectors;
+    uint16_t BytesPerSector;
+    uint32_t ConfigurationParameters;
+} __attribute__((packed)) EDD_DriveParameters;
+
+bool __attribute__((cdecl)) x86_Disk_CheckExtensions(uint8_t drive);
+bool __attribute__((cdecl)) x86_Disk_GetExtendedDriveParams(uint8_t drive, EDD_DriveParameters* paramsOut);
+bool __attribute__((cdecl)) x86_Disk_ExtendedRead(uint8_t drive, EDD_DiskAddressPacket* packet);
+
+// Memory map entry returned by INT 15h EAX=E820h
+typedef struct {
+    uint64_t Base;
+    uint64_t Length;
+    uint32_t Type;
+    uint32_t ACPI;
+} __attribute__((packed)) E820MemoryBlock;
+
+// Returns the number of bytes written to 'block', or -1 on failure. 'continuationId' must be 0 on the first call,
+// it is 0 again after the last entry
+int __attribute__((cdecl)) x86_E820GetNextBlock(E820MemoryBlock* block, uint32_t* continuationId);
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+#include <stdint.h>
+
+// Handed by stage2 to the kernel entry point
+
+#define BOOT_INFO_MAGIC 0x4F454E42          // 'BNEO'
+
+// Stage1 stores its entry timestamp in the BIOS inter-application communication area
+#define BOOT_STAGE1_TSC_ADDR ((volatile uint64_t*) 0x000004F0)
+
+// Checkpoints in boot order, each one marks the end of the phase named after it
+typedef enum {
+    BOOT_PHASE_STAGE1_ENTRY,
+    BOOT_PHASE_STAGE2_ENTRY,
+    BOOT_PHASE_MEMORY_DETECT,
+    BOOT_PHASE_DISK_INIT,
+    BOOT_PHASE_FAT_INIT,
+    BOOT_PHASE_KERNEL_LOAD,
+    BOOT_PHASE_KERNEL_ENTRY,
+    BOOT_PHASE_HAL_INIT,
+    BOOT_PHASE_PMM_INIT,
+    BOOT_PHASE_CPU_INFO,
+
+    BOOT_PHASE_COUNT
+} BootPhase;
+
+typedef struct {
+    uint64_t Tsc;                           // 0 if the checkpoint was never reached
+    uint32_t DiskCalls;                     // BIOS disk transfers so far
+    uint32_t DiskSectors;                   // Sectors read so far
+} __attribute__((packed)) BootCheckpoint;
+
+// Physical memory map as reported by the BIOS (INT 15h, EAX=E820h)
+#define BOOT_MAX_MEMORY_REGIONS 32
+
+typedef enum {
+    MEMORY_REGION_USABLE            = 1,
+    MEMORY_REGION_RESERVED          = 2,
+    MEMORY_REGION_ACPI_RECLAIMABLE  = 3,
+    MEMORY_REGION_ACPI_NVS          = 4,
+    MEMORY_REGION_BAD               = 5,
+} MemoryRegionType;
+
+typedef struct {
+    uint64_t Begin;
+    uint64_t Length;
+    uint32_t Type;                          // MemoryRegionType, anything else is reserved
+    uint32_t ACPI;                          // ACPI 3.0 extended attributes
+} __attribute__((packed)) MemoryRegion;
+
+typedef struct {
+    uint32_t       Magic;
+    uint8_t        BootDrive;
+    BootCheckpoint Checkpoints[BOOT_PHASE_COUNT];
+    uint32_t       MemoryRegionCount;
+    MemoryRegion   MemoryRegions[BOOT_MAX_MEMORY_REGIONS];
+} __attribute__((packed)) BootInfo;
@@ -0,0 +1,9 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+void * memcpy( void * dst, const void * src, size_t num);
+void * memset(void * ptr, int value, size_t num);
+
+// <0, 0 or >0 depending on the first differing byte, compared as unsigned
+int memcmp(const void * ptr1, const void * ptr2, size_t num);
@@ -0,0 +1,18 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+// Provided by the program linking libk, everything below prints through them.
+// flush() is called once at the end of every call below, so the console can batch its updates.
+void putc(char c);
+void flush();
+
+void puts(const char* str);
+void printf(const char* fmt, ...);
+void print_buffer(const char* msg, const void* buffer, uint32_t count);
+
+// printf's formatter, writing each character through 'output'
+typedef void (*FormatOutput)(char c, void* context);
+void vformat(FormatOutput output, void* context, const char* fmt, va_list args);
@@ -1,5 +1,7 @@
 #pragma once
 #include <stddef.h>
+
 const char* strchr(const char* str, char chr);
 char* strcpy(char* dst, const char* src);
-int strlen(const char* str);
\ No newline at end of file
+size_t strlen(const char* str);
+const void* memchr(const void* ptr, int value, size_t num);
@@ -0,0 +1,73 @@
+#include "acpi.h"
+#include <libk/memory.h>
+#include <stddef.h>
+
+// The tables are read in place, they sit in memory the frame allocator never hands out
+
+#define BIOS_EBDA_SEGMENT_ADDR  ((const uint16_t*)0x40E)
+#define BIOS_ROM_BEGIN          0x000E0000
+#define BIOS_ROM_END            0x00100000
+#define EBDA_SEARCH_SIZE        1024
+
+static const ACPI_RSDP* g_Rsdp = NULL;
+static bool g_Searched = false;
+
+static bool ACPI_Checksum(const void* data, uint32_t length){
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint8_t sum = 0;
+    for(uint32_t i = 0; i < length; i++)
+        sum += bytes[i];
+    return sum == 0;
+}
+
+// The RSDP is on a 16 byte boundary, either in the first KiB of the EBDA or in the BIOS ROM
+static const ACPI_RSDP* ACPI_SearchRSDP(uint32_t begin, uint32_t end){
+    for(uint32_t address = begin & ~0xF; address + sizeof(ACPI_RSDP) <= end; address += 16){
+        const ACPI_RSDP* rsdp = (const ACPI_RSDP*)address;
+        if(memcmp(rsdp->Signature, "RSD PTR ", 8) == 0 && ACPI_Checksum(rsdp, sizeof(ACPI_RSDP)))
+            return rsdp;
+    }
+    return NULL;
+}
+
+static const ACPI_RSDP* ACPI_GetRSDP(){
+    if(!g_Searched){
+        uint32_t ebda = (uint32_t)*BIOS_EBDA_SEGMENT_ADDR << 4;
+        if(ebda != 0)
+            g_Rsdp = ACPI_SearchRSDP(ebda, ebda + EBDA_SEARCH_SIZE);
+        if(g_Rsdp == NULL)
+            g_Rsdp = ACPI_SearchRSDP(BIOS_ROM_BEGIN, BIOS_ROM_END);
+        g_Searched = true;
+    }
+    return g_Rsdp;
+}
+
+const ACPI_SDTHeader* ACPI_FindTable(const char* signature){
+    const ACPI_RSDP* rsdp = ACPI_GetRSDP();
+    if(rsdp == NULL)
+        return NULL;
+
+    // the RSDT is enough without PAE, the XSDT would only add 64-bit pointers
+    const ACPI_SDTHeader* rsdt = (const ACPI_SDTHeader*)rsdp->RsdtAddress;
+    if(memcmp(rsdt->Signature, "RSDT", 4) != 0 || !ACPI_Checksum(rsdt, rsdt->Length))
+        return NULL;
+
+    const uint32_t* tables = (const uint32_t*)(rsdt + 1);
+    uint32_t count = (rsdt->Length - sizeof(ACPI_SDTHeader)) / sizeof(uint32_t);
+    for(uint32_t i = 0; i < count; i++){
+        const ACPI_SDTHeader* table = (const ACPI_SDTHeader*)tables[i];
+        if(memcmp(table->Signature, signature, 4) == 0 && ACPI_Checksum(table, table->Length))
+            return table;
+    }
+    return NULL;
+}
+
+const ACPI_MADTEntry* ACPI_MADTNext(const ACPI_MADT* madt, const ACPI_MADTEntry* entry){
+    const uint8_t* end = (const uint8_t*)madt + madt->Header.Length;
+    const uint8_t* next = entry == NULL ? madt->Entries : (const uint8_t*)entry + entry->Length;
+
+    // a zero length record would loop forever
+    if(next + sizeof(ACPI_MADTEntry) > end || ((const ACPI_MADTEntry*)next)->Length < sizeof(ACPI_MADTEntry))
+        return NULL;
+    return (const ACPI_MADTEntry*)next;
+}
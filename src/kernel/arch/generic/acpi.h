@@ -0,0 +1,90 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    char     Signature[8];                  // "RSD PTR "
+    uint8_t  Checksum;
+    char     OemId[6];
+    uint8_t  Revision;
+    uint32_t RsdtAddress;
+} __attribute__((packed)) ACPI_RSDP;
+
+typedef struct {
+    char     Signature[4];
+    uint32_t Length;                        // Including this header
+    uint8_t  Revision;
+    uint8_t  Checksum;
+    char     OemId[6];
+    char     OemTableId[8];
+    uint32_t OemRevision;
+    uint32_t CreatorId;
+    uint32_t CreatorRevision;
+} __attribute__((packed)) ACPI_SDTHeader;
+
+// Multiple APIC Description Table, signature "APIC"
+typedef struct {
+    ACPI_SDTHeader Header;
+    uint32_t       LocalApicAddress;
+    uint32_t       Flags;
+    uint8_t        Entries[];               // ACPI_MADTEntry records up to Header.Length
+} __attribute__((packed)) ACPI_MADT;
+
+#define ACPI_MADT_FLAG_PCAT_COMPAT  (1 << 0)    // Dual 8259 PICs are installed
+
+typedef enum {
+    ACPI_MADT_LOCAL_APIC            = 0,
+    ACPI_MADT_IO_APIC               = 1,
+    ACPI_MADT_INTERRUPT_OVERRIDE    = 2,
+    ACPI_MADT_LOCAL_APIC_NMI        = 4,
+    ACPI_MADT_LOCAL_APIC_OVERRIDE   = 5,
+} ACPI_MADTEntryType;
+
+typedef struct {
+    uint8_t Type;
+    uint8_t Length;
+} __attribute__((packed)) ACPI_MADTEntry;
+
+#define ACPI_MADT_LOCAL_APIC_ENABLED    (1 << 0)
+#define ACPI_MADT_LOCAL_APIC_ONLINE_CAPABLE (1 << 1)
+
+typedef struct {
+    ACPI_MADTEntry Header;
+    uint8_t        ProcessorId;
+    uint8_t        ApicId;
+    uint32_t       Flags;
+} __attribute__((packed)) ACPI_MADTLocalApic;
+
+typedef struct {
+    ACPI_MADTEntry Header;
+    uint8_t        IoApicId;
+    uint8_t        _Reserved;
+    uint32_t       Address;
+    uint32_t       GsiBase;
+} __attribute__((packed)) ACPI_MADTIoApic;
+
+// MPS INTI flags, used by the interrupt source overrides
+#define ACPI_MPS_POLARITY_MASK          0x3
+#define ACPI_MPS_POLARITY_ACTIVE_LOW    0x3
+#define ACPI_MPS_TRIGGER_MASK           0xC
+#define ACPI_MPS_TRIGGER_LEVEL          0xC
+
+typedef struct {
+    ACPI_MADTEntry Header;
+    uint8_t        Bus;                     // Always 0, ISA
+    uint8_t        Source;                  // ISA IRQ
+    uint32_t       Gsi;
+    uint16_t       Flags;
+} __attribute__((packed)) ACPI_MADTInterruptOverride;
+
+typedef struct {
+    ACPI_MADTEntry Header;
+    uint16_t       _Reserved;
+    uint64_t       Address;
+} __attribute__((packed)) ACPI_MADTLocalApicOverride;
+
+// Returns the first table with the given signature, NULL if there's no ACPI or no such table
+const ACPI_SDTHeader* ACPI_FindTable(const char* signature);
+
+// Iterates the MADT records: pass NULL to get the first one, NULL is returned after the last
+const ACPI_MADTEntry* ACPI_MADTNext(const ACPI_MADT* madt, const ACPI_MADTEntry* entry);
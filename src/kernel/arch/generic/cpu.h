@@ -71,4 +71,10 @@ enum {
     CPUID_FEAT_EDX_IA64         = 1 << 30,
     CPUID_FEAT_EDX_PBE          = 1 << 31
 };
+
+// CPUID leaf 7, subleaf 0
+enum {
+    CPUID_FEAT_7_EBX_ERMSB      = 1 << 9,
+};
+int check_apic(void);
 void print_cpu_info();
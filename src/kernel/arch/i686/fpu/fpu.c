@@ -0,0 +1,229 @@
+#include <arch/i686/fpu/fpu.h>
+#include <arch/i686/interrupts/isr.h>
+#include <arch/i686/io.h>
+#include <arch/i686/smp/smp.h>
+#include <arch/generic/cpu.h>
+#include <debug/log.h>
+#include <memory.h>
+
+// Lazy FPU/SSE switching. CR0.TS stays set while the registers don't hold the current
+// context's state: its first FPU/SSE instruction traps with #NM and only then the old
+// owner is saved and the current context restored. Code that never touches the FPU pays nothing.
+// The current context and the owner are per CPU, every CPU has its own registers.
+
+#define CR0_MP                  (1 << 1)
+#define CR0_EM                  (1 << 2)
+#define CR0_TS                  (1 << 3)
+#define CR0_NE                  (1 << 5)
+
+#define CR4_OSFXSR              (1 << 9)
+#define CR4_OSXMMEXCPT          (1 << 10)
+#define CR4_OSXSAVE             (1 << 18)
+
+#define XCR0                    0
+#define XCR0_X87                (1 << 0)
+#define XCR0_SSE                (1 << 1)
+#define XCR0_AVX                (1 << 2)
+
+#define CPUID_LEAF_XSAVE        0x0D
+
+#define FNSAVE_AREA_SIZE        108
+#define FXSAVE_AREA_SIZE        512
+
+#define FPU_NM_VECTOR           7
+
+typedef enum {
+    FPU_SAVE_FNSAVE,
+    FPU_SAVE_FXSAVE,
+    FPU_SAVE_XSAVE,
+} FPUSaveMethod;
+
+// fpu_asm.asm
+void __attribute__((cdecl)) i686_clts();
+void __attribute__((cdecl)) i686_SetTS();
+void __attribute__((cdecl)) i686_fninit();
+void __attribute__((cdecl)) i686_xsetbv(uint32_t xcr, uint64_t value);
+void __attribute__((cdecl)) i686_fnsave(void* area);
+void __attribute__((cdecl)) i686_frstor(const void* area);
+void __attribute__((cdecl)) i686_fxsave(void* area);
+void __attribute__((cdecl)) i686_fxrstor(const void* area);
+void __attribute__((cdecl)) i686_xsave(void* area, uint64_t components);
+void __attribute__((cdecl)) i686_xrstor(const void* area, uint64_t components);
+
+static const char* const g_SaveMethodNames[] = { "fnsave", "fxsave", "xsave" };
+
+static FPUSaveMethod g_SaveMethod;
+static uint64_t g_XSaveComponents;
+static uint32_t g_AreaSize;
+static uint32_t g_CR4Bits;          // What the save method needs, set on every CPU
+static bool g_SSEEnabled;
+
+// Saved right after FNINIT, copied into every new context
+static uint8_t g_InitialArea[FPU_MAX_AREA_SIZE] __attribute__((aligned(FPU_AREA_ALIGN)));
+
+// The boot CPU's context before there is a scheduler, the other CPUs bring their own area
+static uint8_t g_BootArea[FPU_MAX_AREA_SIZE] __attribute__((aligned(FPU_AREA_ALIGN)));
+
+static void i686_FPU_Save(FPUContext* context){
+    switch(g_SaveMethod){
+        case FPU_SAVE_XSAVE:    i686_xsave(context->Area, g_XSaveComponents); break;
+        case FPU_SAVE_FXSAVE:   i686_fxsave(context->Area); break;
+        case FPU_SAVE_FNSAVE:   i686_fnsave(context->Area); break;
+    }
+}
+
+static void i686_FPU_Restore(const FPUContext* context){
+    switch(g_SaveMethod){
+        case FPU_SAVE_XSAVE:    i686_xrstor(context->Area, g_XSaveComponents); break;
+        case FPU_SAVE_FXSAVE:   i686_fxrstor(context->Area); break;
+        case FPU_SAVE_FNSAVE:   i686_frstor(context->Area); break;
+    }
+}
+
+static void i686_FPU_DeviceNotAvailable(Registers* regs){
+    CPU* cpu = i686_CPU_Current();
+    i686_clts();
+    if(cpu->FpuOwner == cpu->FpuCurrent)
+        return;
+
+    if(cpu->FpuOwner != NULL)
+        i686_FPU_Save(cpu->FpuOwner);
+    i686_FPU_Restore(cpu->FpuCurrent);
+    cpu->FpuOwner = cpu->FpuCurrent;
+    cpu->FpuTraps++;
+}
+
+static void i686_FPU_EnableCPU(){
+    uint32_t cr0 = i686_ReadCR0();
+    cr0 &= ~(CR0_EM | CR0_TS);
+    cr0 |= CR0_MP | CR0_NE;
+    i686_WriteCR0(cr0);
+}
+
+// Picks the save instruction and enables the matching CR4/XCR0 bits
+static void i686_FPU_DetectSaveMethod(){
+    unsigned int eax, ebx, ecx, edx;
+
+    g_SaveMethod = FPU_SAVE_FNSAVE;
+    g_AreaSize = FNSAVE_AREA_SIZE;
+    if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(edx & CPUID_FEAT_EDX_FXSR))
+        return;
+
+    g_CR4Bits = CR4_OSFXSR;
+    g_SaveMethod = FPU_SAVE_FXSAVE;
+    g_AreaSize = FXSAVE_AREA_SIZE;
+    if(edx & CPUID_FEAT_EDX_SSE){
+        g_CR4Bits |= CR4_OSXMMEXCPT;
+        g_SSEEnabled = true;
+    }
+
+    uint32_t cr4 = i686_ReadCR4() | g_CR4Bits;
+    if(ecx & CPUID_FEAT_ECX_XSAVE){
+        i686_WriteCR4(cr4 | CR4_OSXSAVE);
+
+        // Only the components we know about, leaf 0xD subleaf 0 then reports the size they need
+        unsigned int supported;
+        __cpuid_count(CPUID_LEAF_XSAVE, 0, supported, ebx, ecx, edx);
+        g_XSaveComponents = supported & (XCR0_X87 | XCR0_SSE | XCR0_AVX);
+        if((g_XSaveComponents & XCR0_AVX) && !(g_XSaveComponents & XCR0_SSE))
+            g_XSaveComponents &= ~XCR0_AVX;
+        i686_xsetbv(XCR0, g_XSaveComponents);
+
+        __cpuid_count(CPUID_LEAF_XSAVE, 0, eax, ebx, ecx, edx);
+        if(ebx <= FPU_MAX_AREA_SIZE){
+            g_SaveMethod = FPU_SAVE_XSAVE;
+            g_AreaSize = ebx;
+            g_CR4Bits |= CR4_OSXSAVE;
+            return;
+        }
+    }
+
+    i686_WriteCR4(cr4);
+}
+
+// Nobody owns the registers yet, the boot context is loaded on its first FPU instruction
+static void i686_FPU_StartCPU(CPU* cpu, void* area){
+    i686_FPU_InitContext(&cpu->BootFpu, area);
+    cpu->FpuCurrent = &cpu->BootFpu;
+    cpu->FpuOwner = NULL;
+    i686_SetTS();
+}
+
+void i686_FPU_Initialize(){
+    i686_FPU_EnableCPU();
+    i686_FPU_DetectSaveMethod();
+
+    FPUContext initial = { g_InitialArea };
+    i686_fninit();
+    i686_FPU_Save(&initial);
+
+    i686_ISR_RegisterHandler(FPU_NM_VECTOR, i686_FPU_DeviceNotAvailable);
+    i686_FPU_StartCPU(i686_CPU_Current(), g_BootArea);
+
+    LOG_INFO(LOG_CPU, "FPU: lazy %s, %u byte save area, SSE %s",
+        g_SaveMethodNames[g_SaveMethod], g_AreaSize, g_SSEEnabled ? "enabled" : "unavailable");
+}
+
+void i686_FPU_InitializeCPU(void* area){
+    i686_FPU_EnableCPU();
+    i686_WriteCR4(i686_ReadCR4() | g_CR4Bits);
+    if(g_SaveMethod == FPU_SAVE_XSAVE)
+        i686_xsetbv(XCR0, g_XSaveComponents);
+
+    i686_fninit();
+    i686_FPU_StartCPU(i686_CPU_Current(), area);
+}
+
+bool i686_FPU_SSEEnabled(){
+    return g_SSEEnabled;
+}
+
+uint32_t i686_FPU_GetAreaSize(){
+    return g_AreaSize;
+}
+
+void i686_FPU_InitContext(FPUContext* context, void* area){
+    context->Area = area;
+    memcpy(area, g_InitialArea, g_AreaSize);
+}
+
+void i686_FPU_ReleaseContext(FPUContext* context){
+    uint32_t flags = i686_SaveInterrupts();
+    CPU* cpu = i686_CPU_Current();
+    if(cpu->FpuOwner == context)
+        cpu->FpuOwner = NULL;
+    i686_RestoreInterrupts(flags);
+}
+
+void i686_FPU_SwitchTo(FPUContext* context){
+    CPU* cpu = i686_CPU_Current();
+    cpu->FpuCurrent = context;
+    if(cpu->FpuOwner == context)
+        i686_clts();
+    else
+        i686_SetTS();
+}
+
+uint32_t i686_FPU_KernelBegin(){
+    uint32_t flags = i686_SaveInterrupts();
+    CPU* cpu = i686_CPU_Current();
+    i686_clts();
+    if(cpu->FpuOwner != NULL){
+        i686_FPU_Save(cpu->FpuOwner);
+        cpu->FpuOwner = NULL;
+    }
+    return flags;
+}
+
+void i686_FPU_KernelEnd(uint32_t flags){
+    // The registers hold kernel scratch now, whoever uses the FPU next reloads its own state
+    i686_SetTS();
+    i686_RestoreInterrupts(flags);
+}
+
+uint32_t i686_FPU_GetTraps(){
+    uint32_t traps = 0;
+    for(uint32_t i = 0; i < i686_SMP_GetCPUCount(); i++)
+        traps += i686_SMP_GetCPU(i)->FpuTraps;
+    return traps;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// Large enough for the x87/SSE/AVX components enabled in XCR0, areas must be 64 byte aligned
+#define FPU_MAX_AREA_SIZE   4096
+#define FPU_AREA_ALIGN      64
+
+// FPU/SSE register state of one execution context
+typedef struct {
+    uint8_t*    Area;           // FNSAVE/FXSAVE/XSAVE image, i686_FPU_GetAreaSize() bytes
+} FPUContext;
+
+void i686_FPU_Initialize();
+
+// Enables the FPU/SSE on an application processor, area is where its boot context lives
+void i686_FPU_InitializeCPU(void* area);
+
+bool i686_FPU_SSEEnabled();
+uint32_t i686_FPU_GetAreaSize();
+
+// Starts the context with the state left by FNINIT (and the default MXCSR)
+void i686_FPU_InitContext(FPUContext* context, void* area);
+
+// The context must not be used afterwards, its area can be freed
+void i686_FPU_ReleaseContext(FPUContext* context);
+
+// Makes context the current one, its state is only loaded once it uses the FPU (#NM).
+// Call with interrupts disabled.
+void i686_FPU_SwitchTo(FPUContext* context);
+
+// Lets kernel code use the FPU/SSE registers in between, with interrupts disabled.
+// The current context's state is saved first if it is live in the registers.
+uint32_t i686_FPU_KernelBegin();
+void i686_FPU_KernelEnd(uint32_t flags);
+
+// Number of #NM traps that loaded a context's state
+uint32_t i686_FPU_GetTraps();
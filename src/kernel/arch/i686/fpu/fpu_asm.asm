@@ -0,0 +1,66 @@
+[bits 32]
+
+global i686_clts ; void i686_clts(), clears CR0.TS
+i686_clts:
+    clts
+    ret
+
+global i686_SetTS ; void i686_SetTS(), the next FPU/SSE instruction traps with #NM
+i686_SetTS:
+    mov eax, cr0
+    or eax, 1 << 3
+    mov cr0, eax
+    ret
+
+global i686_fninit
+i686_fninit:
+    fninit
+    ret
+
+global i686_xsetbv ; void i686_xsetbv(uint32_t xcr, uint64_t value)
+i686_xsetbv:
+    mov ecx, [esp + 4]
+    mov eax, [esp + 8]
+    mov edx, [esp + 12]
+    xsetbv
+    ret
+
+global i686_fnsave ; void i686_fnsave(void* area), also reinitializes the FPU
+i686_fnsave:
+    mov eax, [esp + 4]
+    fnsave [eax]
+    ret
+
+global i686_frstor ; void i686_frstor(const void* area)
+i686_frstor:
+    mov eax, [esp + 4]
+    frstor [eax]
+    ret
+
+global i686_fxsave ; void i686_fxsave(void* area), area 16 byte aligned
+i686_fxsave:
+    mov eax, [esp + 4]
+    fxsave [eax]
+    ret
+
+global i686_fxrstor ; void i686_fxrstor(const void* area)
+i686_fxrstor:
+    mov eax, [esp + 4]
+    fxrstor [eax]
+    ret
+
+global i686_xsave ; void i686_xsave(void* area, uint64_t components), area 64 byte aligned
+i686_xsave:
+    mov ecx, [esp + 4]
+    mov eax, [esp + 8]
+    mov edx, [esp + 12]
+    xsave [ecx]
+    ret
+
+global i686_xrstor ; void i686_xrstor(const void* area, uint64_t components)
+i686_xrstor:
+    mov ecx, [esp + 4]
+    mov eax, [esp + 8]
+    mov edx, [esp + 12]
+    xrstor [ecx]
+    ret
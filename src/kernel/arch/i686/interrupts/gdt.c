@@ -65,7 +65,8 @@ typedef enum{
     GDT_BASE_HIGH(base)                         \
 }
 
-GDTEntry g_GDT[] = {
+// Entries after the kernel segments are filled at runtime, one per-CPU data segment per CPU
+GDTEntry g_GDT[i686_GDT_PERCPU_FIRST + i686_GDT_MAX_CPUS] = {
     // NULL
     GDT_ENTRY(0,0,0,0),
     // Kernel 32-bit code segment                        
@@ -84,8 +85,25 @@ GDTDescriptor g_GDTDescriptor = {sizeof(g_GDT) - 1, g_GDT};
 
 
 void __attribute__((cdecl)) i686_GDT_Load(GDTDescriptor* descriptor, uint16_t codeSegment, uint16_t dataSegment);
+void __attribute__((cdecl)) i686_GDT_LoadGS(uint16_t segment);
 
 
 void i686_GDT_Initialize(){
     i686_GDT_Load(&g_GDTDescriptor, i686_GDT_CODE_SEGMENT, i686_GDT_DATA_SEGMENT);
-}
\ No newline at end of file
+}
+
+const void* i686_GDT_GetDescriptor(){
+    return &g_GDTDescriptor;
+}
+
+void i686_GDT_LoadPerCPU(uint32_t cpu, void* base, uint32_t size){
+    uint32_t address = (uint32_t)base;
+    uint32_t limit = size - 1;
+    GDTEntry entry = GDT_ENTRY(address,
+                               limit,
+                               GDT_ACCESS_PRESENT | GDT_ACCESS_RING0 | GDT_ACCESS_DATA_SEGMENT | GDT_ACCESS_CODE_WRITABLE,
+                               GDT_FLAG_32BIT | GDT_FLAG_GRANULARITY_1B);
+
+    g_GDT[i686_GDT_PERCPU_FIRST + cpu] = entry;
+    i686_GDT_LoadGS(i686_GDT_PERCPU_SEGMENT(cpu));
+}
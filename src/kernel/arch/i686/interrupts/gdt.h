@@ -1,5 +1,18 @@
 #pragma once
+#include <stdint.h>
 
 #define i686_GDT_CODE_SEGMENT 0x08
 #define i686_GDT_DATA_SEGMENT 0x10
-void i686_GDT_Initialize();
\ No newline at end of file
+
+// One data segment per CPU, its base is that CPU's per-CPU block and it lives in GS
+#define i686_GDT_MAX_CPUS               32
+#define i686_GDT_PERCPU_FIRST           3
+#define i686_GDT_PERCPU_SEGMENT(cpu)    ((i686_GDT_PERCPU_FIRST + (cpu)) * 8)
+
+void i686_GDT_Initialize();
+
+// The 6 byte lgdt operand of the kernel GDT, for code that has to load it on its own
+const void* i686_GDT_GetDescriptor();
+
+// Points the CPU's per-CPU segment at [base, base + size) and loads it into GS, call on that CPU
+void i686_GDT_LoadPerCPU(uint32_t cpu, void* base, uint32_t size);
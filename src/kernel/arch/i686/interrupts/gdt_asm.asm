@@ -28,4 +28,11 @@ i686_GDT_Load:
 
     mov esp, ebp
     pop ebp
-    ret
\ No newline at end of file
+    ret
+
+; void __attribute__((cdecl)) i686_GDT_LoadGS(uint16_t segment);
+global i686_GDT_LoadGS
+i686_GDT_LoadGS:
+    mov ax, [esp + 4]
+    mov gs, ax
+    ret
@@ -2,26 +2,34 @@
 #include <arch/i686/io.h>
 #include "stdio.h"
 #include <util/arrays.h>
+#include <debug/log.h>
+#include <arch/i686/smp/smp.h>
+#include <sched/sched.h>
+#include <sched/work.h>
 #include <stddef.h>
 
 #define PIC_REMAP_OFFSET 0x20
+#define EFLAGS_IF        (1 << 9)
+#define IRQ_BENCHMARK_ROUNDS 10000
 
+// Called directly by irq_common (isr_asm.asm), never NULL once initialized
 IRQHandler g_IRQHandlers[16];
+void (*g_IRQSendEOI)(int irq);
 static const PICDriver* g_Driver = NULL;
 
-void i686_IRQ_Handler(Registers* regs){
-    int irq = regs->interrupt - PIC_REMAP_OFFSET;
-    if(g_IRQHandlers[irq] != NULL){
-        g_IRQHandlers[irq](regs);
-    }else{
-        printf("Unhandled IRQ %d ...\n", irq);
-    }
-    g_Driver->SendEOI(irq);
+static void i686_IRQ_Unhandled(Registers* regs){
+    LOG_WARN(LOG_INTERRUPTS, "Unhandled IRQ %d", regs->interrupt - PIC_REMAP_OFFSET);
 }
 
 void i686_IRQ_Initialize(){
-    
+    for(int i = 0; i < 16; i++){
+        if(g_IRQHandlers[i] == NULL)
+            g_IRQHandlers[i] = i686_IRQ_Unhandled;
+    }
+
+    // in order of preference
     const PICDriver* drivers[] = {
+        APIC_GetDriver(),
         i8259_GetDriver(),
     };
 
@@ -34,17 +42,72 @@ void i686_IRQ_Initialize(){
 
     if(g_Driver == NULL){
         printf("WARNING: No PIC!\r\n");
+        return;
     }
 
     printf("Found %s\n\r", g_Driver->Name);
     g_Driver->Initialize(PIC_REMAP_OFFSET, PIC_REMAP_OFFSET + 8,false);
 
-    for(int i = 0; i < 16; i++){
-        i686_ISR_RegisterHandler(PIC_REMAP_OFFSET + i, i686_IRQ_Handler);
-    }
+    g_IRQSendEOI = g_Driver->SendEOI;
     i686_sti();
 }
 
 void i686_IRQ_RegisterHandler(int irq, IRQHandler handler){
-    g_IRQHandlers[irq] = handler;
-}
\ No newline at end of file
+    g_IRQHandlers[irq] = handler != NULL ? handler : i686_IRQ_Unhandled;
+    if(g_Driver != NULL)
+        g_Driver->Unmask(irq);
+}
+
+void i686_IRQ_RequestExitWork(uint32_t work){
+    uint32_t flags = i686_SaveInterrupts();
+    i686_CPU_Current()->IRQExitWork |= work;
+    i686_RestoreInterrupts(flags);
+}
+
+void __attribute__((cdecl)) i686_IRQ_Exit(Registers* regs){
+    CPU* cpu = i686_CPU_Current();
+    if(!(regs->eflags & EFLAGS_IF) || cpu->InDeferredWork)
+        return;
+
+    // deferred work can ask for more, e.g. by waking a thread
+    uint32_t work;
+    while((work = cpu->IRQExitWork) != 0){
+        cpu->IRQExitWork = 0;
+
+        if(work & IRQ_EXIT_DEFERRED_WORK)
+            WORK_Run();
+        // threads only run on the boot CPU
+        if((work & IRQ_EXIT_RESCHEDULE) && cpu->Index == 0)
+            SCHED_Preempt();
+    }
+}
+
+static void i686_IRQ_BenchmarkHandler(Registers* regs){
+}
+
+// Round trip of a software interrupt through the IRQ stubs vs. the generic isr_common path
+void i686_IRQ_Benchmark(){
+    if(g_Driver == NULL)
+        return;
+
+    // IRQ 15 stays masked, int $0x2F still goes through its stub and sends a (harmless) EOI
+    IRQHandler saved = g_IRQHandlers[15];
+    g_IRQHandlers[15] = i686_IRQ_BenchmarkHandler;
+
+    uint64_t start = i686_rdtsc();
+    for(int i = 0; i < IRQ_BENCHMARK_ROUNDS; i++)
+        __asm__ volatile("int $0x2F" ::: "memory");
+    uint64_t fast = i686_rdtsc() - start;
+    g_IRQHandlers[15] = saved;
+
+    i686_ISR_RegisterHandler(0x30, i686_IRQ_BenchmarkHandler);
+    start = i686_rdtsc();
+    for(int i = 0; i < IRQ_BENCHMARK_ROUNDS; i++)
+        __asm__ volatile("int $0x30" ::: "memory");
+    uint64_t generic = i686_rdtsc() - start;
+    i686_ISR_RegisterHandler(0x30, NULL);
+
+    i686_ISR_ResetStats();
+    printf("[IRQ] entry round trip: fast %u cycles, generic %u cycles\r\n",
+        (uint32_t)(fast / IRQ_BENCHMARK_ROUNDS), (uint32_t)(generic / IRQ_BENCHMARK_ROUNDS));
+}
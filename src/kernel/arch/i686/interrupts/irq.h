@@ -2,9 +2,24 @@
 
 #include <arch/i686/interrupts/isr.h>
 #include <arch/i686/pic/i8259.h>
+#include <arch/i686/pic/apic.h>
 #include <arch/i686/pic/pic.h>
 
 typedef void (*IRQHandler) (Registers* regs);
 
 void i686_IRQ_Initialize();
-void i686_IRQ_RegisterHandler(int irq, IRQHandler handler);
\ No newline at end of file
+void i686_IRQ_RegisterHandler(int irq, IRQHandler handler);
+void i686_IRQ_Benchmark();
+
+// Work requested from interrupt context, done by i686_IRQ_Exit once the handler returned and
+// the EOI went out. Skipped (and kept pending) if the interrupted code had interrupts disabled
+// or was running deferred work. Per CPU, in CPU.IRQExitWork.
+enum {
+    IRQ_EXIT_RESCHEDULE     = 1 << 0,
+    IRQ_EXIT_DEFERRED_WORK  = 1 << 1,
+};
+
+// Flags work for the calling CPU's next i686_IRQ_Exit
+void i686_IRQ_RequestExitWork(uint32_t work);
+
+void __attribute__((cdecl)) i686_IRQ_Exit(Registers* regs);
@@ -1,11 +1,16 @@
 #include <arch/i686/interrupts/isr.h>
 #include <arch/i686/interrupts/idt.h>
 #include <arch/i686/interrupts/gdt.h>
+#include <arch/i686/interrupts/irq.h>
+#include <arch/i686/smp/smp.h>
 #include <arch/i686/io.h>
 #include <stdio.h>
 #include <stddef.h>
+#include <libk/memory.h>
+#include <debug/log.h>
 
 ISRHandler g_ISRHandler[256];
+ISRStats g_BootISRStats[ISR_VECTORS];
 
 static const char* const g_Exceptions[] = {
     "Divide by zero error",
@@ -51,38 +56,109 @@ void i686_ISR_Initialize(){
     }
 }
 
+static void i686_ISR_Account(ISRStats* stats, uint64_t cycles64){
+    uint32_t cycles = cycles64 > UINT32_MAX ? UINT32_MAX : (uint32_t)cycles64;
+
+    stats->Count++;
+    stats->TotalCycles += cycles;
+    if(cycles > stats->MaxCycles)
+        stats->MaxCycles = cycles;
+
+    int bucket = cycles != 0 ? 31 - __builtin_clz(cycles) : 0;
+    if(bucket >= ISR_HISTOGRAM_BUCKETS)
+        bucket = ISR_HISTOGRAM_BUCKETS - 1;
+    stats->Histogram[bucket]++;
+}
+
 void __attribute__((cdecl)) i686_ISR_Handler(Registers* regs){
     if(g_ISRHandler[regs->interrupt] != NULL){
+        uint64_t start = i686_rdtsc();
         g_ISRHandler[regs->interrupt](regs);
+        i686_ISR_Account(&i686_CPU_Current()->ISRStats[regs->interrupt], i686_rdtsc() - start);
+        if(i686_CPU_Current()->IRQExitWork != 0)
+            i686_IRQ_Exit(regs);
     }else if(regs->interrupt >= 32){
         printf("Unhandled interrupt %d!\r\n",regs->interrupt);
     }else{
-        printf("===   KERNEL PANIC   ===\r\n");
-        printf("========================\r\n");
-        printf("Unhandled interrupt!\nException: %s (%d)!\r\n",g_Exceptions[regs->interrupt],regs->interrupt);
-        printf("========================\r\n");
-        printf("ds=%d\r\n",regs->ds);
-        printf("edi=%d\r\n",regs->edi);
-        printf("esi=%d\r\n",regs->esi);
-        printf("ebp=%d\r\n",regs->ebp);
-        printf("kern_esp=%d\r\n",regs->kern_esp);
-        printf("ebx=%d\r\n",regs->ebx);
-        printf("edx=%d\r\n",regs->edx);
-        printf("ecx=%d\r\n",regs->ecx);
-        printf("eax=%d\r\n",regs->eax);
-        printf("interrupt=%d\r\n",regs->interrupt);
-        printf("error=%d\r\n",regs->error);
-        printf("eip=%d\r\n",regs->eip);
-        printf("cs=%d\r\n",regs->cs);
-        printf("eflags=%d\r\n",regs->eflags);
-        printf("esp=%d\r\n",regs->esp);
-        printf("ss=%d\r\n",regs->ss);
-        printf("========================\r\n");
-        i686_panic();
+        i686_ISR_Panic(regs, "Unhandled interrupt!");
     }
 }
+
+void i686_ISR_Panic(Registers* regs, const char* message){
+    printf("===   KERNEL PANIC   ===\r\n");
+    printf("========================\r\n");
+    printf("%s\nException: %s (%d)!\r\n",message,g_Exceptions[regs->interrupt],regs->interrupt);
+    printf("========================\r\n");
+    printf("ds=%d\r\n",regs->ds);
+    printf("edi=%d\r\n",regs->edi);
+    printf("esi=%d\r\n",regs->esi);
+    printf("ebp=%d\r\n",regs->ebp);
+    printf("kern_esp=%d\r\n",regs->kern_esp);
+    printf("ebx=%d\r\n",regs->ebx);
+    printf("edx=%d\r\n",regs->edx);
+    printf("ecx=%d\r\n",regs->ecx);
+    printf("eax=%d\r\n",regs->eax);
+    printf("interrupt=%d\r\n",regs->interrupt);
+    printf("error=%d\r\n",regs->error);
+    printf("eip=%d\r\n",regs->eip);
+    printf("cs=%d\r\n",regs->cs);
+    printf("eflags=%d\r\n",regs->eflags);
+    printf("esp=%d\r\n",regs->esp);
+    printf("ss=%d\r\n",regs->ss);
+    printf("========================\r\n");
+    i686_ISR_DumpStats();
+    i686_panic();
+}
 void i686_ISR_RegisterHandler(int interrupt, ISRHandler handler)
 {
     g_ISRHandler[interrupt] = handler;
     i686_IDT_EnableGate(interrupt);
-}
\ No newline at end of file
+}
+
+// Another CPU may be counting while its numbers are read or cleared, they are only statistics
+void i686_ISR_GetStats(int interrupt, ISRStats* statsOut){
+    memset(statsOut, 0, sizeof(ISRStats));
+    for(uint32_t i = 0; i < i686_SMP_GetCPUCount(); i++){
+        uint32_t flags = i686_SaveInterrupts();
+        ISRStats stats = i686_SMP_GetCPU(i)->ISRStats[interrupt];
+        i686_RestoreInterrupts(flags);
+
+        statsOut->Count += stats.Count;
+        statsOut->TotalCycles += stats.TotalCycles;
+        if(stats.MaxCycles > statsOut->MaxCycles)
+            statsOut->MaxCycles = stats.MaxCycles;
+        for(int bucket = 0; bucket < ISR_HISTOGRAM_BUCKETS; bucket++)
+            statsOut->Histogram[bucket] += stats.Histogram[bucket];
+    }
+}
+
+void i686_ISR_ResetStats(){
+    for(uint32_t i = 0; i < i686_SMP_GetCPUCount(); i++){
+        uint32_t flags = i686_SaveInterrupts();
+        memset(i686_SMP_GetCPU(i)->ISRStats, 0, ISR_VECTORS * sizeof(ISRStats));
+        i686_RestoreInterrupts(flags);
+    }
+}
+
+void i686_ISR_DumpStats(){
+    LOG_Printf("===== INTERRUPT STATS =====\r\n");
+    for(int i = 0; i < ISR_VECTORS; i++){
+        // copy first, so the numbers of one vector are consistent with each other
+        ISRStats stats;
+        i686_ISR_GetStats(i, &stats);
+
+        if(stats.Count == 0)
+            continue;
+
+        LOG_Printf("vector %d: %d calls, avg %lld cycles, max %d cycles\r\n",
+                   i, stats.Count, stats.TotalCycles / stats.Count, stats.MaxCycles);
+        LOG_Printf("  cycles >= 2^n:");
+        for(int bucket = 0; bucket < ISR_HISTOGRAM_BUCKETS; bucket++){
+            if(stats.Histogram[bucket] != 0)
+                LOG_Printf(" [%d] %d", bucket, stats.Histogram[bucket]);
+        }
+        LOG_Printf("\r\n");
+    }
+    LOG_Printf("===== INTERRUPT STATS =====\r\n");
+    LOG_Flush();
+}
@@ -11,5 +11,31 @@ typedef struct{
 
 typedef void (*ISRHandler)(Registers* regs);
 
+#define ISR_VECTORS 256
+
+// Bucket i counts the handlers that took [2^i, 2^(i+1)) cycles, the last one everything above
+#define ISR_HISTOGRAM_BUCKETS 26
+
+typedef struct{
+    uint32_t    Count;
+    uint32_t    MaxCycles;
+    uint64_t    TotalCycles;
+    uint32_t    Histogram[ISR_HISTOGRAM_BUCKETS];
+}__attribute__((aligned(64))) ISRStats;
+
+// irq_common in isr_asm.asm updates these directly
+_Static_assert(sizeof(ISRStats) == 128, "isr_asm.asm expects 128 byte ISRStats");
+
+// Each CPU counts in its own array, see CPU.ISRStats. This one is the boot CPU's.
+extern ISRStats g_BootISRStats[ISR_VECTORS];
+
 void i686_ISR_Initialize();
-void i686_ISR_RegisterHandler(int interrupt, ISRHandler handler);
\ No newline at end of file
+void i686_ISR_RegisterHandler(int interrupt, ISRHandler handler);
+
+// Register dump and halt, for exceptions the kernel can't recover from
+void i686_ISR_Panic(Registers* regs, const char* message);
+
+// Per-vector counters and handler cycles, measured around the dispatch with RDTSC, summed over the CPUs
+void i686_ISR_GetStats(int interrupt, ISRStats* statsOut);
+void i686_ISR_ResetStats();
+void i686_ISR_DumpStats();
@@ -16,22 +16,46 @@
         jmp isr_common
 %endmacro
 
+; hardware IRQs, dispatched straight to g_IRQHandlers by irq_common
+%macro  IRQ_FAST 1
+    global i686_ISR%1
+    i686_ISR%1:
+        push 0
+        push %1
+        jmp irq_common
+%endmacro
+
 extern i686_ISR_Handler
+extern g_IRQHandlers
+extern g_IRQSendEOI
+extern i686_IRQ_Exit
+
+KERNEL_DATA_SEGMENT     equ 0x10
+IRQ_VECTOR_BASE         equ 0x20    ; must match PIC_REMAP_OFFSET in irq.c
+CPU_IRQ_EXIT_WORK       equ 4       ; offsetof(CPU, IRQExitWork), must match smp.h
+CPU_ISR_STATS           equ 8       ; offsetof(CPU, ISRStats)
+
+; ISRStats layout, must match isr.h
+ISRSTATS_SHIFT          equ 7       ; sizeof(ISRStats) == 128
+ISRSTATS_COUNT          equ 0
+ISRSTATS_MAX            equ 4
+ISRSTATS_TOTAL          equ 8
+ISRSTATS_HISTOGRAM      equ 16
+ISR_HISTOGRAM_BUCKETS   equ 26
 
 %include "arch/i686/isrs_gen.inc"
 
 isr_common:
+    cld
     pusha               ; pushes all registers
 
     xor eax, eax
     mov ax, ds
     push eax
 
-    mov ax, 0x10        ; use kernel data segment
+    mov ax, 0x10        ; use kernel data segment, gs keeps pointing at the per-CPU block
     mov ds, ax
     mov es, ax
-    mov fs, ax
-    mov gs, ax
 
     push esp            ; pass pointer to stack to C
 
@@ -41,9 +65,90 @@ isr_common:
     pop eax             ; restore old segment
     mov ds, ax
     mov es, ax
-    mov fs, ax
-    mov gs, ax
 
     popa                ; restore what we pushed
     add esp, 8          ; remove error code and interrupt number
-    iret                ; will pop: cs, eip, eflags, ss, esp
\ No newline at end of file
+    iret                ; will pop: cs, eip, eflags, ss, esp
+
+; Same Registers frame as isr_common, but the data segments are only reloaded when we didn't
+; come from kernel code, and the handler is called without going through i686_ISR_Handler
+irq_common:
+    cld
+    pusha
+
+    xor eax, eax
+    mov ax, ds
+    push eax
+    cmp ax, KERNEL_DATA_SEGMENT
+    je .kernel_segments
+
+    mov ax, KERNEL_DATA_SEGMENT
+    mov ds, ax
+    mov es, ax
+
+.kernel_segments:
+    mov ebx, [esp + 36]                 ; interrupt number, callee saved from here on
+
+    rdtsc
+    mov esi, eax
+    mov edi, edx
+
+    push esp                            ; pass pointer to stack to C
+    call [g_IRQHandlers + ebx * 4 - IRQ_VECTOR_BASE * 4]
+    add esp, 4
+
+    lea eax, [ebx - IRQ_VECTOR_BASE]
+    push eax
+    call [g_IRQSendEOI]
+    add esp, 4
+
+    ; eax = cycles, saturated to 32 bits
+    rdtsc
+    sub eax, esi
+    sbb edx, edi
+    jz .account
+    mov eax, 0xFFFFFFFF
+
+.account:
+    shl ebx, ISRSTATS_SHIFT
+    add ebx, [gs:CPU_ISR_STATS]         ; this CPU's, nobody else writes them
+
+    inc dword [ebx + ISRSTATS_COUNT]
+    add [ebx + ISRSTATS_TOTAL], eax
+    adc dword [ebx + ISRSTATS_TOTAL + 4], 0
+
+    cmp eax, [ebx + ISRSTATS_MAX]
+    jbe .histogram
+    mov [ebx + ISRSTATS_MAX], eax
+
+.histogram:
+    xor ecx, ecx
+    test eax, eax
+    jz .bucket
+    bsr ecx, eax                        ; bucket = log2(cycles)
+    cmp ecx, ISR_HISTOGRAM_BUCKETS - 1
+    jbe .bucket
+    mov ecx, ISR_HISTOGRAM_BUCKETS - 1
+
+.bucket:
+    inc dword [ebx + ISRSTATS_HISTOGRAM + ecx * 4]
+
+    ; after the EOI, so whatever runs there doesn't hold the line
+    cmp dword [gs:CPU_IRQ_EXIT_WORK], 0
+    je .exit_done
+    push esp
+    call i686_IRQ_Exit
+    add esp, 4
+
+.exit_done:
+    pop eax
+    cmp ax, KERNEL_DATA_SEGMENT
+    je .restored
+
+    mov ds, ax
+    mov es, ax
+
+.restored:
+    popa
+    add esp, 8          ; remove error code and interrupt number
+    iret
@@ -9,5 +9,23 @@ uint8_t __attribute__((cdecl)) i686_inl(uint16_t port);
 
 void __attribute__((cdecl)) i686_cli();
 void __attribute__((cdecl)) i686_sti();
+
+// Disables interrupts, returning the previous EFLAGS for i686_RestoreInterrupts
+uint32_t __attribute__((cdecl)) i686_SaveInterrupts();
+void __attribute__((cdecl)) i686_RestoreInterrupts(uint32_t flags);
+
+void __attribute__((cdecl)) i686_outsb(uint16_t port, const void* data, uint32_t count);
 void i686_iowait();
+uint64_t __attribute__((cdecl)) i686_rdtsc();
+uint64_t __attribute__((cdecl)) i686_rdmsr(uint32_t msr);
+void __attribute__((cdecl)) i686_wrmsr(uint32_t msr, uint64_t value);
+uint32_t __attribute__((cdecl)) i686_ReadCR0();
+void __attribute__((cdecl)) i686_WriteCR0(uint32_t value);
+uint32_t __attribute__((cdecl)) i686_ReadCR4();
+void __attribute__((cdecl)) i686_WriteCR4(uint32_t value);
+uint32_t __attribute__((cdecl)) i686_ReadCR2();
+uint32_t __attribute__((cdecl)) i686_ReadCR3();
+void __attribute__((cdecl)) i686_WriteCR3(uint32_t value);
+void __attribute__((cdecl)) i686_invlpg(uint32_t address);
+void __attribute__((cdecl)) i686_hlt();
 void __attribute__((cdecl)) i686_panic();
\ No newline at end of file
@@ -43,6 +43,99 @@ i686_sti:
     sti
     ret
 
+global i686_SaveInterrupts ; uint32_t i686_SaveInterrupts(), returns EFLAGS
+i686_SaveInterrupts:
+    pushfd
+    pop eax
+    cli
+    ret
+
+global i686_RestoreInterrupts ; void i686_RestoreInterrupts(uint32_t flags)
+i686_RestoreInterrupts:
+    push dword [esp + 4]
+    popfd
+    ret
+
+global i686_outsb
+i686_outsb:
+    [bits 32]
+    ; [esp + 4] = port, [esp + 8] = data, [esp + 12] = count
+    push esi
+    mov dx, [esp + 8]
+    mov esi, [esp + 12]
+    mov ecx, [esp + 16]
+    rep outsb
+    pop esi
+    ret
+
+global i686_rdtsc ; uint64_t i686_rdtsc(), result in edx:eax
+i686_rdtsc:
+    rdtsc
+    ret
+
+global i686_rdmsr ; uint64_t i686_rdmsr(uint32_t msr)
+i686_rdmsr:
+    mov ecx, [esp + 4]
+    rdmsr
+    ret
+
+global i686_wrmsr ; void i686_wrmsr(uint32_t msr, uint64_t value)
+i686_wrmsr:
+    mov ecx, [esp + 4]
+    mov eax, [esp + 8]
+    mov edx, [esp + 12]
+    wrmsr
+    ret
+
+global i686_ReadCR0 ; uint32_t i686_ReadCR0()
+i686_ReadCR0:
+    mov eax, cr0
+    ret
+
+global i686_WriteCR0 ; void i686_WriteCR0(uint32_t value)
+i686_WriteCR0:
+    mov eax, [esp + 4]
+    mov cr0, eax
+    ret
+
+global i686_ReadCR4 ; uint32_t i686_ReadCR4()
+i686_ReadCR4:
+    mov eax, cr4
+    ret
+
+global i686_WriteCR4 ; void i686_WriteCR4(uint32_t value)
+i686_WriteCR4:
+    mov eax, [esp + 4]
+    mov cr4, eax
+    ret
+
+global i686_ReadCR2 ; uint32_t i686_ReadCR2()
+i686_ReadCR2:
+    mov eax, cr2
+    ret
+
+global i686_ReadCR3 ; uint32_t i686_ReadCR3()
+i686_ReadCR3:
+    mov eax, cr3
+    ret
+
+global i686_WriteCR3 ; void i686_WriteCR3(uint32_t value)
+i686_WriteCR3:
+    mov eax, [esp + 4]
+    mov cr3, eax
+    ret
+
+global i686_invlpg ; void i686_invlpg(uint32_t address)
+i686_invlpg:
+    mov eax, [esp + 4]
+    invlpg [eax]
+    ret
+
+global i686_hlt ; Waits for the next interrupt
+i686_hlt:
+    hlt
+    ret
+
 global i686_panic
 i686_panic:
     cli
@@ -0,0 +1,341 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <arch/i686/pic/apic.h>
+#include <arch/i686/pic/i8259.h>
+#include <arch/i686/interrupts/isr.h>
+#include <arch/i686/io.h>
+#include <arch/generic/acpi.h>
+#include <arch/generic/cpu.h>
+#include <debug/log.h>
+#include <time/clock.h>
+#include <mm/pmm.h>
+#include <mm/vmm.h>
+
+// Local APIC + I/O APIC. The ISA IRQs are routed through the first I/O APIC,
+// EOIs are a single write to the local APIC instead of port I/O on the 8259s.
+
+#define APIC_BASE_MSR                   0x1B
+#define APIC_BASE_MSR_ENABLE            (1 << 11)
+#define APIC_BASE_MSR_ADDRESS_MASK      0xFFFFF000
+
+// Local APIC registers, offsets from its base
+#define LAPIC_REG_ID                    0x020
+#define LAPIC_REG_VERSION               0x030
+#define LAPIC_REG_TPR                   0x080
+#define LAPIC_REG_EOI                   0x0B0
+#define LAPIC_REG_SVR                   0x0F0
+#define LAPIC_REG_ICR_LOW               0x300
+#define LAPIC_REG_ICR_HIGH              0x310
+#define LAPIC_REG_LVT_TIMER             0x320
+#define LAPIC_REG_TIMER_INITIAL         0x380
+#define LAPIC_REG_TIMER_CURRENT         0x390
+#define LAPIC_REG_TIMER_DIVIDE          0x3E0
+
+#define LAPIC_SVR_ENABLE                (1 << 8)
+#define LAPIC_LVT_MASKED                (1 << 16)
+#define LAPIC_TIMER_DIVIDE_16           0x3
+
+#define LAPIC_ICR_FIXED                 (0 << 8)
+#define LAPIC_ICR_INIT                  (5 << 8)
+#define LAPIC_ICR_STARTUP               (6 << 8)
+#define LAPIC_ICR_PENDING               (1 << 12)
+#define LAPIC_ICR_ASSERT                (1 << 14)
+
+// I/O APIC registers, reached through the select/window pair
+#define IOAPIC_SELECT                   0x00
+#define IOAPIC_WINDOW                   0x10
+
+#define IOAPIC_REG_VERSION              0x01
+#define IOAPIC_REG_REDIRECTION(n)       (0x10 + 2 * (n))
+
+#define IOAPIC_REDIRECTION_ACTIVE_LOW   (1 << 13)
+#define IOAPIC_REDIRECTION_LEVEL        (1 << 15)
+#define IOAPIC_REDIRECTION_MASKED       (1 << 16)
+
+// Low 4 bits must be set on older local APICs
+#define APIC_SPURIOUS_VECTOR            0xFF
+
+// Local APIC timer, one-shot mode
+#define APIC_TIMER_VECTOR               0xF0
+#define APIC_TIMER_CALIBRATION_NS       10000000ULL
+
+#define APIC_ISA_IRQS                   16
+#define APIC_NO_GSI                     0xFFFFFFFF
+
+static volatile uint32_t* g_LocalApic = NULL;
+static volatile uint32_t* g_IoApic = NULL;
+static uint32_t g_IoApicGsiBase;
+static uint32_t g_IoApicRedirections;
+static bool g_Configured = false;
+
+// counts = (ns * g_TimerMult) >> 32
+static uint32_t g_TimerMult;
+static uint64_t g_TimerMaxDeltaNs;
+static ClockEventHandler g_TimerHandler = NULL;
+
+// Where each ISA IRQ ends up on the I/O APIC, and the polarity/trigger bits of its redirection entry
+static uint32_t g_IrqGsi[APIC_ISA_IRQS];
+static uint32_t g_IrqFlags[APIC_ISA_IRQS];
+
+static uint32_t LAPIC_Read(uint32_t reg){
+    return g_LocalApic[reg / sizeof(uint32_t)];
+}
+
+static void LAPIC_Write(uint32_t reg, uint32_t value){
+    g_LocalApic[reg / sizeof(uint32_t)] = value;
+}
+
+static uint32_t IOAPIC_Read(uint8_t reg){
+    g_IoApic[IOAPIC_SELECT / sizeof(uint32_t)] = reg;
+    return g_IoApic[IOAPIC_WINDOW / sizeof(uint32_t)];
+}
+
+static void IOAPIC_Write(uint8_t reg, uint32_t value){
+    g_IoApic[IOAPIC_SELECT / sizeof(uint32_t)] = reg;
+    g_IoApic[IOAPIC_WINDOW / sizeof(uint32_t)] = value;
+}
+
+uint8_t APIC_GetLocalId(){
+    return LAPIC_Read(LAPIC_REG_ID) >> 24;
+}
+
+static void APIC_SpuriousHandler(Registers* regs){
+    // spurious interrupts must not be acknowledged
+}
+
+bool APIC_IsEnabled(){
+    return g_Configured;
+}
+
+void APIC_InitializeCPU(){
+    uint64_t base = i686_rdmsr(APIC_BASE_MSR);
+    i686_wrmsr(APIC_BASE_MSR, base | APIC_BASE_MSR_ENABLE);
+
+    LAPIC_Write(LAPIC_REG_TPR, 0);
+    LAPIC_Write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED | APIC_TIMER_VECTOR);
+    LAPIC_Write(LAPIC_REG_SVR, LAPIC_SVR_ENABLE | APIC_SPURIOUS_VECTOR);
+}
+
+static void APIC_SendCommand(uint8_t apicId, uint32_t command){
+    uint32_t flags = i686_SaveInterrupts();
+    while(LAPIC_Read(LAPIC_REG_ICR_LOW) & LAPIC_ICR_PENDING)
+        ;
+    LAPIC_Write(LAPIC_REG_ICR_HIGH, (uint32_t)apicId << 24);
+    LAPIC_Write(LAPIC_REG_ICR_LOW, command);
+    while(LAPIC_Read(LAPIC_REG_ICR_LOW) & LAPIC_ICR_PENDING)
+        ;
+    i686_RestoreInterrupts(flags);
+}
+
+void APIC_SendINIT(uint8_t apicId){
+    APIC_SendCommand(apicId, LAPIC_ICR_INIT | LAPIC_ICR_ASSERT);
+}
+
+void APIC_SendStartup(uint8_t apicId, uint8_t page){
+    APIC_SendCommand(apicId, LAPIC_ICR_STARTUP | LAPIC_ICR_ASSERT | page);
+}
+
+void APIC_SendIPI(uint8_t apicId, uint8_t vector){
+    APIC_SendCommand(apicId, LAPIC_ICR_FIXED | LAPIC_ICR_ASSERT | vector);
+}
+
+bool APIC_Probe(){
+    if(!check_apic())
+        return false;
+
+    const ACPI_MADT* madt = (const ACPI_MADT*)ACPI_FindTable("APIC");
+    if(madt == NULL)
+        return false;
+
+    uint32_t localApic = madt->LocalApicAddress;
+    for(int irq = 0; irq < APIC_ISA_IRQS; irq++){
+        g_IrqGsi[irq] = irq;
+        g_IrqFlags[irq] = 0;                // ISA defaults: edge triggered, active high
+    }
+
+    g_IoApic = NULL;
+    for(const ACPI_MADTEntry* entry = ACPI_MADTNext(madt, NULL); entry != NULL; entry = ACPI_MADTNext(madt, entry)){
+        switch(entry->Type){
+            case ACPI_MADT_IO_APIC:{
+                const ACPI_MADTIoApic* ioApic = (const ACPI_MADTIoApic*)entry;
+                if(g_IoApic == NULL){
+                    g_IoApic = (volatile uint32_t*)ioApic->Address;
+                    g_IoApicGsiBase = ioApic->GsiBase;
+                }
+                break;
+            }
+            case ACPI_MADT_INTERRUPT_OVERRIDE:{
+                const ACPI_MADTInterruptOverride* override = (const ACPI_MADTInterruptOverride*)entry;
+                if(override->Bus != 0 || override->Source >= APIC_ISA_IRQS)
+                    break;
+
+                // the IRQ that used to sit on that pin isn't wired there anymore
+                for(int irq = 0; irq < APIC_ISA_IRQS; irq++){
+                    if(irq != override->Source && g_IrqGsi[irq] == override->Gsi)
+                        g_IrqGsi[irq] = APIC_NO_GSI;
+                }
+
+                g_IrqGsi[override->Source] = override->Gsi;
+                if((override->Flags & ACPI_MPS_POLARITY_MASK) == ACPI_MPS_POLARITY_ACTIVE_LOW)
+                    g_IrqFlags[override->Source] |= IOAPIC_REDIRECTION_ACTIVE_LOW;
+                if((override->Flags & ACPI_MPS_TRIGGER_MASK) == ACPI_MPS_TRIGGER_LEVEL)
+                    g_IrqFlags[override->Source] |= IOAPIC_REDIRECTION_LEVEL;
+                break;
+            }
+            case ACPI_MADT_LOCAL_APIC_OVERRIDE:{
+                const ACPI_MADTLocalApicOverride* override = (const ACPI_MADTLocalApicOverride*)entry;
+                if(override->Address < 0x100000000ULL)
+                    localApic = (uint32_t)override->Address;
+                break;
+            }
+        }
+    }
+
+    if(g_IoApic == NULL)
+        return false;
+
+    g_LocalApic = (volatile uint32_t*)localApic;
+    VMM_MapDevice(localApic, PAGE_SIZE);
+    VMM_MapDevice((uint32_t)g_IoApic, PAGE_SIZE);
+    g_IoApicRedirections = ((IOAPIC_Read(IOAPIC_REG_VERSION) >> 16) & 0xFF) + 1;
+    return true;
+}
+
+static bool APIC_GetEntry(int irq, uint8_t* entryOut){
+    if(irq < 0 || irq >= APIC_ISA_IRQS || g_IrqGsi[irq] == APIC_NO_GSI)
+        return false;
+
+    uint32_t entry = g_IrqGsi[irq] - g_IoApicGsiBase;
+    if(g_IrqGsi[irq] < g_IoApicGsiBase || entry >= g_IoApicRedirections)
+        return false;
+
+    *entryOut = entry;
+    return true;
+}
+
+void APIC_Mask(int irq){
+    uint8_t entry;
+    if(APIC_GetEntry(irq, &entry))
+        IOAPIC_Write(IOAPIC_REG_REDIRECTION(entry), IOAPIC_Read(IOAPIC_REG_REDIRECTION(entry)) | IOAPIC_REDIRECTION_MASKED);
+}
+
+void APIC_Unmask(int irq){
+    uint8_t entry;
+    if(APIC_GetEntry(irq, &entry))
+        IOAPIC_Write(IOAPIC_REG_REDIRECTION(entry), IOAPIC_Read(IOAPIC_REG_REDIRECTION(entry)) & ~IOAPIC_REDIRECTION_MASKED);
+}
+
+void APIC_Disable(){
+    for(uint32_t entry = 0; entry < g_IoApicRedirections; entry++)
+        IOAPIC_Write(IOAPIC_REG_REDIRECTION(entry), IOAPIC_Read(IOAPIC_REG_REDIRECTION(entry)) | IOAPIC_REDIRECTION_MASKED);
+}
+
+void APIC_SendEOI(int irq){
+    LAPIC_Write(LAPIC_REG_EOI, 0);
+}
+
+// No auto EOI on the APIC, 'autoEOI' is ignored. IRQ n is delivered on vector offsetPic1 + n.
+void APIC_Configure(uint8_t offsetPic1, uint8_t offsetPic2, bool autoEOI){
+    // the 8259s stay wired to LINT0, remap them away from the exceptions and mask everything
+    const PICDriver* legacy = i8259_GetDriver();
+    legacy->Initialize(offsetPic1, offsetPic2, false);
+    legacy->Disable();
+
+    i686_ISR_RegisterHandler(APIC_SPURIOUS_VECTOR, APIC_SpuriousHandler);
+    APIC_InitializeCPU();
+
+    APIC_Disable();
+
+    // physical destination mode, everything goes to this CPU
+    uint8_t destination = APIC_GetLocalId();
+    for(int irq = 0; irq < APIC_ISA_IRQS; irq++){
+        uint8_t entry;
+        if(!APIC_GetEntry(irq, &entry))
+            continue;
+
+        IOAPIC_Write(IOAPIC_REG_REDIRECTION(entry) + 1, (uint32_t)destination << 24);
+        IOAPIC_Write(IOAPIC_REG_REDIRECTION(entry), (offsetPic1 + irq) | g_IrqFlags[irq] | IOAPIC_REDIRECTION_MASKED);
+    }
+
+    g_Configured = true;
+    LOG_INFO(LOG_INTERRUPTS, "Local APIC 0x%x (id %d), I/O APIC 0x%x with %d inputs from GSI %d",
+             (uint32_t)g_LocalApic, destination, (uint32_t)g_IoApic, g_IoApicRedirections, g_IoApicGsiBase);
+}
+
+static const PICDriver g_ApicDriver = {
+    .Name = "APIC",
+    .Probe = &APIC_Probe,
+    .Initialize = &APIC_Configure,
+    .Disable = &APIC_Disable,
+    .SendEOI = &APIC_SendEOI,
+    .Mask = &APIC_Mask,
+    .Unmask = &APIC_Unmask
+};
+
+const PICDriver* APIC_GetDriver(){
+    return &g_ApicDriver;
+}
+
+// Counts the timer's rate against the TSC clock, needs CLOCK_Initialize and the APIC driver in use
+static bool APIC_TimerProbe(){
+    if(!g_Configured || g_Clock.Mult == 0)
+        return false;
+
+    LAPIC_Write(LAPIC_REG_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_16);
+    LAPIC_Write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED | APIC_TIMER_VECTOR);
+
+    uint32_t flags = i686_SaveInterrupts();
+    LAPIC_Write(LAPIC_REG_TIMER_INITIAL, UINT32_MAX);
+    uint64_t start = ktime_ns();
+    while(ktime_ns() - start < APIC_TIMER_CALIBRATION_NS)
+        ;
+    uint32_t counts = UINT32_MAX - LAPIC_Read(LAPIC_REG_TIMER_CURRENT);
+    uint64_t elapsed = ktime_ns() - start;
+    LAPIC_Write(LAPIC_REG_TIMER_INITIAL, 0);
+    i686_RestoreInterrupts(flags);
+
+    uint64_t hz = (uint64_t)counts * 1000000000ULL / elapsed;
+    if(hz == 0 || hz >= 1000000000ULL)
+        return false;
+
+    g_TimerMult = (uint32_t)(((hz << 32) + 500000000ULL) / 1000000000ULL);
+    g_TimerMaxDeltaNs = (uint64_t)UINT32_MAX * 1000000000ULL / hz;
+    LOG_INFO(LOG_INTERRUPTS, "Local APIC timer: %u kHz", (uint32_t)(hz / 1000));
+    return true;
+}
+
+static void APIC_TimerInterrupt(Registers* regs){
+    g_TimerHandler();
+    LAPIC_Write(LAPIC_REG_EOI, 0);
+}
+
+static void APIC_TimerInitialize(ClockEventHandler handler){
+    g_TimerHandler = handler;
+    i686_ISR_RegisterHandler(APIC_TIMER_VECTOR, APIC_TimerInterrupt);
+    LAPIC_Write(LAPIC_REG_LVT_TIMER, APIC_TIMER_VECTOR);
+}
+
+static uint64_t APIC_TimerSetNextEvent(uint64_t deltaNs){
+    if(deltaNs > g_TimerMaxDeltaNs)
+        deltaNs = g_TimerMaxDeltaNs;
+
+    // the rounded up multiplier can overshoot by a count at the maximum
+    uint64_t counts = CLOCK_MulShift(deltaNs, g_TimerMult, 32);
+    if(counts > UINT32_MAX)
+        counts = UINT32_MAX;
+    LAPIC_Write(LAPIC_REG_TIMER_INITIAL, counts != 0 ? (uint32_t)counts : 1);
+    return deltaNs;
+}
+
+static const ClockEventDevice g_ApicTimer = {
+    .Name = "Local APIC timer",
+    .Probe = &APIC_TimerProbe,
+    .Initialize = &APIC_TimerInitialize,
+    .SetNextEvent = &APIC_TimerSetNextEvent,
+};
+
+const ClockEventDevice* APIC_GetClockEvent(){
+    return &g_ApicTimer;
+}
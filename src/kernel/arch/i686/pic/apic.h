@@ -0,0 +1,26 @@
+#pragma once
+#include <stdint.h>
+#include <arch/i686/pic/pic.h>
+#include <arch/i686/timer/clockevent.h>
+
+const PICDriver* APIC_GetDriver();
+
+// Local APIC of the calling CPU
+uint8_t APIC_GetLocalId();
+
+// Local APIC timer, usable once the APIC driver is the one in use
+const ClockEventDevice* APIC_GetClockEvent();
+
+// Whether the APIC driver is the one in use
+bool APIC_IsEnabled();
+
+// Enables the calling CPU's local APIC, its timer masked. Run on every application processor.
+void APIC_InitializeCPU();
+
+// Acknowledges the interrupt being handled on the calling CPU, 'irq' is ignored
+void APIC_SendEOI(int irq);
+
+// Inter-processor interrupts, to the local APIC with the given id
+void APIC_SendINIT(uint8_t apicId);
+void APIC_SendStartup(uint8_t apicId, uint8_t page);     // The CPU starts in real mode at page * 4 KiB
+void APIC_SendIPI(uint8_t apicId, uint8_t vector);
@@ -0,0 +1,174 @@
+#include <arch/i686/smp/smp.h>
+#include <arch/i686/interrupts/idt.h>
+#include <arch/i686/pic/apic.h>
+#include <arch/i686/io.h>
+#include <arch/generic/acpi.h>
+#include <mm/pmm.h>
+#include <mm/vmm.h>
+#include <time/clock.h>
+#include <sched/work.h>
+#include <debug/log.h>
+#include <memory.h>
+#include <stddef.h>
+
+// The trampoline is copied to a free page below 1 MiB, the startup IPI carries its page number
+#define SMP_TRAMPOLINE_ADDRESS      0x70000
+
+// Each application processor gets one PMM block: its boot FPU area at the bottom, the stack on top
+#define SMP_CPU_ORDER               2                                   // 16 KiB
+#define SMP_CPU_SIZE                (PAGE_SIZE << SMP_CPU_ORDER)
+
+// And one for its interrupt counters
+#define SMP_ISR_STATS_ORDER         3                                   // 32 KiB
+
+// Intel MP spec: 10 ms after INIT, 200 us between the two startup IPIs
+#define SMP_INIT_DELAY_NS           10000000ULL
+#define SMP_STARTUP_DELAY_NS        200000ULL
+#define SMP_ONLINE_TIMEOUT_NS       1000000000ULL
+
+_Static_assert(sizeof(CPU) % CACHE_LINE_SIZE == 0, "per-CPU blocks must not share cache lines");
+_Static_assert(offsetof(CPU, IRQExitWork) == 4, "isr_asm.asm reads it at %gs:4");
+_Static_assert(offsetof(CPU, ISRStats) == 8, "isr_asm.asm reads it at %gs:8");
+_Static_assert(ISR_VECTORS * sizeof(ISRStats) == PAGE_SIZE << SMP_ISR_STATS_ORDER, "ISR stats block size");
+
+// smp_asm.asm
+extern uint8_t i686_SMP_Trampoline[];
+extern uint8_t i686_SMP_TrampolineGDT[];
+extern uint8_t i686_SMP_TrampolineEnd[];
+
+// Handed to the CPU being started, only one is started at a time
+volatile CPU* g_SMPStartingCPU;
+volatile uint32_t g_SMPStartingStack;
+
+static CPU g_CPUs[SMP_MAX_CPUS];
+static uint32_t g_CPUCount = 1;
+
+static void i686_SMP_LoadCPU(CPU* cpu){
+    cpu->Self = cpu;
+    i686_GDT_LoadPerCPU(cpu->Index, cpu, sizeof(CPU));
+}
+
+static bool i686_SMP_WaitOnline(CPU* cpu, uint64_t timeoutNs){
+    uint64_t start = ktime_ns();
+    while(!cpu->Online){
+        if(ktime_ns() - start >= timeoutNs)
+            return false;
+    }
+    return true;
+}
+
+void i686_SMP_InitializeBoot(){
+    CPU* cpu = &g_CPUs[0];
+    cpu->Index = 0;
+    cpu->Block = 0;
+    cpu->ISRStats = g_BootISRStats;
+    cpu->Online = true;
+    i686_SMP_LoadCPU(cpu);
+}
+
+// Where the trampoline lands, on the CPU's own stack
+void __attribute__((cdecl)) i686_SMP_ApMain(){
+    CPU* cpu = (CPU*)g_SMPStartingCPU;
+    if(VMM_IsEnabled())
+        VMM_InitializeCPU();
+    i686_SMP_LoadCPU(cpu);
+
+    i686_IDT_Initialize();
+    APIC_InitializeCPU();
+    i686_FPU_InitializeCPU((void*)cpu->Block);
+
+    cpu->Online = true;
+
+    // work queued here by other CPUs comes with an IPI, whose exit runs it
+    i686_sti();
+    for(;;){
+        WORK_Run();
+        if(!WORK_HasPending())
+            i686_hlt();
+    }
+}
+
+static bool i686_SMP_StartCPU(uint8_t apicId){
+    uint32_t block = PMM_AllocPages(SMP_CPU_ORDER);
+    uint32_t stats = PMM_AllocPages(SMP_ISR_STATS_ORDER);
+    if(block == 0 || stats == 0){
+        if(block != 0)
+            PMM_FreePages(block, SMP_CPU_ORDER);
+        if(stats != 0)
+            PMM_FreePages(stats, SMP_ISR_STATS_ORDER);
+        return false;
+    }
+    memset((void*)stats, 0, PAGE_SIZE << SMP_ISR_STATS_ORDER);
+
+    CPU* cpu = &g_CPUs[g_CPUCount];
+    cpu->Index = g_CPUCount;
+    cpu->ApicId = apicId;
+    cpu->Block = block;
+    cpu->ISRStats = (ISRStats*)stats;
+    cpu->Online = false;
+
+    g_SMPStartingCPU = cpu;
+    g_SMPStartingStack = block + SMP_CPU_SIZE;
+
+    APIC_SendINIT(apicId);
+    uint64_t start = ktime_ns();
+    while(ktime_ns() - start < SMP_INIT_DELAY_NS)
+        ;
+
+    // the second startup IPI is only for CPUs that missed the first one
+    APIC_SendStartup(apicId, SMP_TRAMPOLINE_ADDRESS >> 12);
+    if(!i686_SMP_WaitOnline(cpu, SMP_STARTUP_DELAY_NS)){
+        APIC_SendStartup(apicId, SMP_TRAMPOLINE_ADDRESS >> 12);
+        if(!i686_SMP_WaitOnline(cpu, SMP_ONLINE_TIMEOUT_NS)){
+            // park it again before its stack goes away
+            APIC_SendINIT(apicId);
+            PMM_FreePages(block, SMP_CPU_ORDER);
+            PMM_FreePages(stats, SMP_ISR_STATS_ORDER);
+            return false;
+        }
+    }
+
+    g_CPUCount++;
+    return true;
+}
+
+void i686_SMP_Initialize(){
+    const ACPI_MADT* madt = (const ACPI_MADT*)ACPI_FindTable("APIC");
+    if(!APIC_IsEnabled() || madt == NULL || g_Clock.Mult == 0){
+        LOG_INFO(LOG_CPU, "SMP: needs the APIC and a calibrated clock, only the boot CPU runs");
+        return;
+    }
+
+    g_CPUs[0].ApicId = APIC_GetLocalId();
+
+    // the trampoline loads the kernel GDT and jumps to i686_SMP_ApStart
+    memcpy((void*)SMP_TRAMPOLINE_ADDRESS, i686_SMP_Trampoline, i686_SMP_TrampolineEnd - i686_SMP_Trampoline);
+    memcpy((uint8_t*)SMP_TRAMPOLINE_ADDRESS + (i686_SMP_TrampolineGDT - i686_SMP_Trampoline), i686_GDT_GetDescriptor(), 6);
+
+    for(const ACPI_MADTEntry* entry = ACPI_MADTNext(madt, NULL); entry != NULL; entry = ACPI_MADTNext(madt, entry)){
+        if(entry->Type != ACPI_MADT_LOCAL_APIC)
+            continue;
+
+        const ACPI_MADTLocalApic* localApic = (const ACPI_MADTLocalApic*)entry;
+        if(!(localApic->Flags & ACPI_MADT_LOCAL_APIC_ENABLED) || localApic->ApicId == g_CPUs[0].ApicId)
+            continue;
+
+        if(g_CPUCount >= SMP_MAX_CPUS){
+            LOG_WARN(LOG_CPU, "SMP: more than %d CPUs, the rest stay off", SMP_MAX_CPUS);
+            break;
+        }
+
+        if(!i686_SMP_StartCPU(localApic->ApicId))
+            LOG_WARN(LOG_CPU, "SMP: CPU with APIC id %d didn't come up", localApic->ApicId);
+    }
+
+    LOG_INFO(LOG_CPU, "SMP: %u CPUs online", g_CPUCount);
+}
+
+uint32_t i686_SMP_GetCPUCount(){
+    return g_CPUCount;
+}
+
+CPU* i686_SMP_GetCPU(uint32_t index){
+    return index < g_CPUCount ? &g_CPUs[index] : NULL;
+}
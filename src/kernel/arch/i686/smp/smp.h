@@ -0,0 +1,50 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <arch/i686/fpu/fpu.h>
+#include <arch/i686/interrupts/gdt.h>
+#include <arch/i686/interrupts/isr.h>
+
+// Application processors are started with INIT-SIPI-SIPI through a real-mode trampoline.
+// Every CPU has a per-CPU block, reached through the base of its own GDT segment in GS.
+
+#define SMP_MAX_CPUS            i686_GDT_MAX_CPUS
+#define CACHE_LINE_SIZE         64
+
+typedef struct CPU CPU;
+
+// Fields a CPU only touches itself come first, what other CPUs write goes on lines of its own
+struct CPU{
+    CPU*            Self;               // %gs:0, see i686_CPU_Current
+    volatile uint32_t IRQExitWork;      // IRQ_EXIT_* bits, irq_common reads them at %gs:4
+    ISRStats*       ISRStats;           // ISR_VECTORS of them, irq_common reads the pointer at %gs:8
+    uint32_t        Index;
+    uint8_t         ApicId;
+    bool            InDeferredWork;     // WORK_Run is on the stack
+    uint32_t        Block;              // PMM block of the stack and boot FPU area, 0 on the boot CPU
+
+    FPUContext      BootFpu;            // What runs before there are threads
+    FPUContext*     FpuCurrent;         // Context of the code that is running
+    FPUContext*     FpuOwner;           // Context whose state is in the registers, NULL if nobody's
+    uint32_t        FpuTraps;
+    uint32_t        WorkItemsRun;
+
+    volatile bool   Online __attribute__((aligned(CACHE_LINE_SIZE)));
+    struct WorkItem* volatile WorkQueue;    // Lock-free, newest first, any CPU pushes
+    volatile bool   TlbFlushPending;    // A CPU that changed a mapping waits for this one to flush it
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+// Sets up the boot CPU's block, right after the GDT
+void i686_SMP_InitializeBoot();
+
+// Starts the other CPUs listed in the MADT, each ends up idle. Needs the APIC, the clock and the PMM.
+void i686_SMP_Initialize();
+
+uint32_t i686_SMP_GetCPUCount();
+CPU* i686_SMP_GetCPU(uint32_t index);
+
+static inline CPU* i686_CPU_Current(){
+    CPU* cpu;
+    __asm__ volatile("movl %%gs:0, %0" : "=r"(cpu));
+    return cpu;
+}
@@ -0,0 +1,59 @@
+; Real-mode trampoline for the application processors. i686_SMP_Initialize copies
+; i686_SMP_Trampoline..i686_SMP_TrampolineEnd to a page below 1 MiB and fills in the GDT pointer,
+; the startup IPI then starts the CPU there with cs = page << 8 and ip = 0.
+
+extern g_SMPStartingStack
+extern i686_SMP_ApMain
+
+KERNEL_CODE_SEGMENT     equ 0x08
+KERNEL_DATA_SEGMENT     equ 0x10
+
+[bits 16]
+
+global i686_SMP_Trampoline
+global i686_SMP_TrampolineGDT
+global i686_SMP_TrampolineEnd
+
+i686_SMP_Trampoline:
+    cli
+    cld
+
+    mov ax, cs
+    mov ds, ax
+
+    ; the kernel GDT sits above 1 MiB, the 32 bit operand size loads all of its base
+    o32 lgdt [i686_SMP_TrampolineGDT - i686_SMP_Trampoline]
+
+    mov eax, cr0
+    or al, 1
+    mov cr0, eax
+
+    jmp dword KERNEL_CODE_SEGMENT:i686_SMP_ApStart
+
+    align 4
+i686_SMP_TrampolineGDT:
+    dw 0                    ; limit
+    dd 0                    ; base
+
+i686_SMP_TrampolineEnd:
+
+[bits 32]
+
+; Runs from the kernel image, in protected mode
+i686_SMP_ApStart:
+    mov ax, KERNEL_DATA_SEGMENT
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov ss, ax
+
+    mov esp, [g_SMPStartingStack]
+    xor ebp, ebp
+
+    call i686_SMP_ApMain
+
+.halt:
+    cli
+    hlt
+    jmp .halt
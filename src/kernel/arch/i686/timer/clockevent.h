@@ -0,0 +1,16 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef void (*ClockEventHandler)();
+
+// One-shot interrupt source driving the timer subsystem
+typedef struct{
+    const char* Name;
+    bool (*Probe)();
+    void (*Initialize)(ClockEventHandler handler);
+
+    // Interrupts once, deltaNs from now. Returns the delay actually programmed,
+    // shorter than asked if it is past what the hardware can count.
+    uint64_t (*SetNextEvent)(uint64_t deltaNs);
+} ClockEventDevice;
@@ -0,0 +1,86 @@
+#include <arch/i686/timer/pit.h>
+#include <arch/i686/io.h>
+#include <arch/i686/interrupts/irq.h>
+#include <time/clock.h>
+#include <stddef.h>
+
+#define PIT_CHANNEL0_PORT           0x40
+#define PIT_CHANNEL2_PORT           0x42
+#define PIT_COMMAND_PORT            0x43
+#define PIT_GATE_PORT               0x61    // Keyboard controller port B
+
+#define PIT_GATE_CHANNEL2           (1 << 0)
+#define PIT_GATE_SPEAKER            (1 << 1)
+#define PIT_GATE_CHANNEL2_OUT       (1 << 5)
+
+#define PIT_IRQ                     0
+#define PIT_MAX_TICKS               0xFFFF
+#define PIT_MAX_DELTA_NS            ((uint64_t)PIT_MAX_TICKS * 1000000000ULL / PIT_FREQUENCY)
+
+// ticks = (ns * PIT_NS_TO_TICKS_MULT) >> 32
+#define PIT_NS_TO_TICKS_MULT        ((uint32_t)(((uint64_t)PIT_FREQUENCY << 32) / 1000000000ULL))
+
+enum {
+    PIT_CMD_CHANNEL0            = 0x00,
+    PIT_CMD_CHANNEL2            = 0x80,
+    PIT_CMD_ACCESS_LOHI         = 0x30,
+    PIT_CMD_MODE0               = 0x00,     // Interrupt on terminal count: out goes high at 0 and stays there
+};
+
+void i686_PIT_Channel2Start(uint16_t ticks){
+    uint8_t gate = i686_inb(PIT_GATE_PORT) & ~(PIT_GATE_SPEAKER | PIT_GATE_CHANNEL2);
+
+    // Gate low while loading, the count starts on the rising edge
+    i686_outb(PIT_GATE_PORT, gate);
+    i686_outb(PIT_COMMAND_PORT, PIT_CMD_CHANNEL2 | PIT_CMD_ACCESS_LOHI | PIT_CMD_MODE0);
+    i686_outb(PIT_CHANNEL2_PORT, ticks & 0xFF);
+    i686_outb(PIT_CHANNEL2_PORT, ticks >> 8);
+    i686_outb(PIT_GATE_PORT, gate | PIT_GATE_CHANNEL2);
+}
+
+bool i686_PIT_Channel2Expired(){
+    return (i686_inb(PIT_GATE_PORT) & PIT_GATE_CHANNEL2_OUT) != 0;
+}
+
+static ClockEventHandler g_Handler = NULL;
+
+static void i686_PIT_Interrupt(Registers* regs){
+    g_Handler();
+}
+
+static bool i686_PIT_Probe(){
+    return true;
+}
+
+static uint64_t i686_PIT_SetNextEvent(uint64_t deltaNs){
+    if(deltaNs > PIT_MAX_DELTA_NS)
+        deltaNs = PIT_MAX_DELTA_NS;
+
+    uint32_t ticks = (uint32_t)CLOCK_MulShift(deltaNs, PIT_NS_TO_TICKS_MULT, 32);
+    if(ticks == 0)
+        ticks = 1;
+
+    i686_outb(PIT_COMMAND_PORT, PIT_CMD_CHANNEL0 | PIT_CMD_ACCESS_LOHI | PIT_CMD_MODE0);
+    i686_outb(PIT_CHANNEL0_PORT, ticks & 0xFF);
+    i686_outb(PIT_CHANNEL0_PORT, ticks >> 8);
+    return deltaNs;
+}
+
+static void i686_PIT_Initialize(ClockEventHandler handler){
+    g_Handler = handler;
+
+    // Stop the BIOS' periodic mode before IRQ0 gets unmasked, this fires once and then stays quiet
+    i686_PIT_SetNextEvent(PIT_MAX_DELTA_NS);
+    i686_IRQ_RegisterHandler(PIT_IRQ, i686_PIT_Interrupt);
+}
+
+static const ClockEventDevice g_PitClockEvent = {
+    .Name = "PIT",
+    .Probe = &i686_PIT_Probe,
+    .Initialize = &i686_PIT_Initialize,
+    .SetNextEvent = &i686_PIT_SetNextEvent,
+};
+
+const ClockEventDevice* i686_PIT_GetClockEvent(){
+    return &g_PitClockEvent;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <arch/i686/timer/clockevent.h>
+
+// Input clock of the 8253/8254 PIT
+#define PIT_FREQUENCY 1193182
+
+// Channel 2 (the speaker channel) counts down once from ticks, with its output readable through port 0x61.
+// Nothing is connected to an interrupt, so it can be polled with interrupts off.
+void i686_PIT_Channel2Start(uint16_t ticks);
+bool i686_PIT_Channel2Expired();
+
+// Channel 0 in mode 0 on IRQ0, at most 0xFFFF ticks (~55 ms) per event
+const ClockEventDevice* i686_PIT_GetClockEvent();
@@ -0,0 +1,77 @@
+#include "timeline.h"
+#include <arch/i686/io.h>
+#include <time/clock.h>
+#include <stdio.h>
+#include <stddef.h>
+
+#define SECTOR_SIZE 512
+
+static const char* const g_PhaseNames[BOOT_PHASE_COUNT] = {
+    [BOOT_PHASE_STAGE1_ENTRY]   = "stage1",
+    [BOOT_PHASE_STAGE2_ENTRY]   = "stage1 -> stage2",
+    [BOOT_PHASE_MEMORY_DETECT]  = "Memory_Detect",
+    [BOOT_PHASE_DISK_INIT]      = "DISK_Initialize",
+    [BOOT_PHASE_FAT_INIT]       = "FAT_Initialize",
+    [BOOT_PHASE_KERNEL_LOAD]    = "kernel load",
+    [BOOT_PHASE_KERNEL_ENTRY]   = "stage2 -> kernel",
+    [BOOT_PHASE_HAL_INIT]       = "HAL_Inizialize",
+    [BOOT_PHASE_PMM_INIT]       = "PMM_Initialize",
+    [BOOT_PHASE_CPU_INFO]       = "print_cpu_info",
+};
+
+// Kept in the kernel image, stage2's memory may be reused once the kernel is up
+static BootInfo g_BootInfo;
+
+void BOOT_TimelineInitialize(const BootInfo* bootInfo){
+    if(bootInfo != NULL && bootInfo->Magic == BOOT_INFO_MAGIC){
+        g_BootInfo = *bootInfo;
+    }else{
+        printf("[BOOT] No boot info from stage2, timeline starts at the kernel\r\n");
+    }
+}
+
+void BOOT_Checkpoint(BootPhase phase){
+    BootCheckpoint* checkpoint = &g_BootInfo.Checkpoints[phase];
+    checkpoint->Tsc = i686_rdtsc();
+
+    // the kernel doesn't touch the disk (yet), carry the stage2 totals forward
+    checkpoint->DiskCalls = g_BootInfo.Checkpoints[BOOT_PHASE_KERNEL_LOAD].DiskCalls;
+    checkpoint->DiskSectors = g_BootInfo.Checkpoints[BOOT_PHASE_KERNEL_LOAD].DiskSectors;
+}
+
+void BOOT_PrintTimeline(){
+    const BootCheckpoint* previous = NULL;
+    const BootCheckpoint* first = NULL;
+    const BootCheckpoint* last = NULL;
+
+    printf("===== BOOT TIMELINE =====\r\n");
+    for(int i = 0; i < BOOT_PHASE_COUNT; i++){
+        const BootCheckpoint* checkpoint = &g_BootInfo.Checkpoints[i];
+        if(checkpoint->Tsc == 0)
+            continue;
+
+        if(previous != NULL){
+            uint32_t sectors = checkpoint->DiskSectors - previous->DiskSectors;
+            uint64_t cycles = checkpoint->Tsc - previous->Tsc;
+            printf("%s: %lld cycles (%u us), %d disk calls, %d sectors (%d bytes)\r\n",
+                   g_PhaseNames[i],
+                   cycles,
+                   (uint32_t)(CLOCK_CyclesToNs(cycles) / 1000),
+                   checkpoint->DiskCalls - previous->DiskCalls,
+                   sectors,
+                   sectors * SECTOR_SIZE);
+        }else{
+            first = checkpoint;
+        }
+
+        previous = checkpoint;
+        last = checkpoint;
+    }
+
+    if(first != NULL && last != first){
+        uint64_t cycles = last->Tsc - first->Tsc;
+        printf("total: %lld cycles (%u us), %d disk calls, %d sectors\r\n",
+               cycles, (uint32_t)(CLOCK_CyclesToNs(cycles) / 1000), last->DiskCalls, last->DiskSectors);
+    }
+    printf("===== BOOT TIMELINE =====\r\n");
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include <boot/bootinfo.h>
+
+void BOOT_TimelineInitialize(const BootInfo* bootInfo);
+void BOOT_Checkpoint(BootPhase phase);
+void BOOT_PrintTimeline();
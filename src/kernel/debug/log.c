@@ -0,0 +1,137 @@
+#include "log.h"
+#include <arch/i686/io.h>
+#include <sched/spinlock.h>
+#include <libk/stdio.h>
+#include <stdarg.h>
+
+#define DEBUGCON_PORT       0xE9
+
+// Power of two, so the positions can run freely and be masked on access
+#define LOG_BUFFER_SIZE     4096
+#define LOG_BUFFER_MASK     (LOG_BUFFER_SIZE - 1)
+
+// Messages at or above this level are drained right away, in case the next thing we do is hang
+#define LOG_FLUSH_LEVEL     LOG_LEVEL_WARN
+
+// Drained as soon as this much is buffered
+#define LOG_FLUSH_THRESHOLD (LOG_BUFFER_SIZE / 2)
+
+LogLevel g_LogLevel = LOG_LEVEL_INFO;
+uint32_t g_LogMask = LOG_ALL;
+
+static char g_LogBuffer[LOG_BUFFER_SIZE];
+static uint32_t g_LogHead = 0;          // Next position to write
+static uint32_t g_LogTail = 0;          // Next position to send
+static Spinlock g_LogLock = SPINLOCK_INIT;  // The buffer and the port, any CPU logs
+
+static const char* const g_LevelNames[] = {
+    [LOG_LEVEL_DEBUG]   = "DEBUG",
+    [LOG_LEVEL_INFO]    = "INFO",
+    [LOG_LEVEL_WARN]    = "WARN",
+    [LOG_LEVEL_ERROR]   = "ERROR",
+    [LOG_LEVEL_PANIC]   = "PANIC",
+};
+
+static const char* const g_SubsystemNames[] = {
+    "KERNEL",
+    "BOOT",
+    "MEMORY",
+    "INTERRUPTS",
+    "CPU",
+};
+
+void LOG_SetLevel(LogLevel level){
+    g_LogLevel = level;
+}
+
+void LOG_SetMask(uint32_t subsystems){
+    g_LogMask = subsystems;
+}
+
+// g_LogLock held
+static void LOG_Drain(){
+    while(g_LogTail != g_LogHead){
+        uint32_t start = g_LogTail & LOG_BUFFER_MASK;
+        uint32_t count = g_LogHead - g_LogTail;
+
+        // up to the end of the buffer, the wrapped part goes on the next round
+        if(start + count > LOG_BUFFER_SIZE)
+            count = LOG_BUFFER_SIZE - start;
+
+        i686_outsb(DEBUGCON_PORT, &g_LogBuffer[start], count);
+        g_LogTail += count;
+    }
+}
+
+// g_LogLock held
+static void LOG_Append(char c, void* context){
+    if(g_LogHead - g_LogTail == LOG_BUFFER_SIZE)
+        LOG_Drain();
+
+    g_LogBuffer[g_LogHead & LOG_BUFFER_MASK] = c;
+    g_LogHead++;
+}
+
+static void LOG_AppendString(const char* str){
+    while(*str)
+        LOG_Append(*str++, NULL);
+}
+
+static const char* LOG_SubsystemName(LogSubsystem subsystem){
+    for(int i = 0; i < sizeof(g_SubsystemNames) / sizeof(g_SubsystemNames[0]); i++){
+        if(subsystem & (1u << i))
+            return g_SubsystemNames[i];
+    }
+    return "?";
+}
+
+void LOG_Write(LogSubsystem subsystem, LogLevel level, const char* fmt, ...){
+    if(!LOG_ENABLED(subsystem, level))
+        return;
+
+    uint32_t flags = SPINLOCK_Acquire(&g_LogLock);
+
+    LOG_Append('[', NULL);
+    LOG_AppendString(g_LevelNames[level]);
+    LOG_AppendString("] [");
+    LOG_AppendString(LOG_SubsystemName(subsystem));
+    LOG_AppendString("] ");
+
+    va_list args;
+    va_start(args, fmt);
+    vformat(LOG_Append, NULL, fmt, args);
+    va_end(args);
+
+    LOG_AppendString("\r\n");
+
+    if(level >= LOG_FLUSH_LEVEL || g_LogHead - g_LogTail >= LOG_FLUSH_THRESHOLD)
+        LOG_Drain();
+
+    SPINLOCK_Release(&g_LogLock, flags);
+}
+
+void LOG_Printf(const char* fmt, ...){
+    uint32_t flags = SPINLOCK_Acquire(&g_LogLock);
+
+    va_list args;
+    va_start(args, fmt);
+    vformat(LOG_Append, NULL, fmt, args);
+    va_end(args);
+
+    if(g_LogHead - g_LogTail >= LOG_FLUSH_THRESHOLD)
+        LOG_Drain();
+
+    SPINLOCK_Release(&g_LogLock, flags);
+}
+
+void LOG_Putc(char c){
+    uint32_t flags = SPINLOCK_Acquire(&g_LogLock);
+    LOG_Append(c, NULL);
+    SPINLOCK_Release(&g_LogLock, flags);
+}
+
+void LOG_Flush(){
+    uint32_t flags = SPINLOCK_Acquire(&g_LogLock);
+    LOG_Drain();
+    SPINLOCK_Release(&g_LogLock, flags);
+}
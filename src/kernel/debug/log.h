@@ -0,0 +1,54 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// Kernel log, buffered in memory and drained to the debugcon port (0xE9).
+// Safe to call from interrupt handlers and from any CPU. Filtered messages cost a compare, their arguments aren't even formatted.
+
+typedef enum {
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_PANIC,
+} LogLevel;
+
+typedef enum {
+    LOG_KERNEL      = 1 << 0,
+    LOG_BOOT        = 1 << 1,
+    LOG_MEMORY      = 1 << 2,
+    LOG_INTERRUPTS  = 1 << 3,
+    LOG_CPU         = 1 << 4,
+
+    LOG_ALL         = 0xFFFFFFFF,
+} LogSubsystem;
+
+extern LogLevel g_LogLevel;
+extern uint32_t g_LogMask;
+
+void LOG_SetLevel(LogLevel level);
+void LOG_SetMask(uint32_t subsystems);
+
+void LOG_Write(LogSubsystem subsystem, LogLevel level, const char* fmt, ...);
+
+// Unfiltered and without prefix, for dumps requested on purpose
+void LOG_Printf(const char* fmt, ...);
+
+// Raw characters for the debugcon, used by the console so printf output shows up there too
+void LOG_Putc(char c);
+
+// Sends everything buffered to the debugcon
+void LOG_Flush();
+
+#define LOG_ENABLED(subsystem, level) ((level) >= g_LogLevel && ((subsystem) & g_LogMask))
+
+#define LOG(subsystem, level, ...)                          \
+    do {                                                    \
+        if(LOG_ENABLED(subsystem, level))                   \
+            LOG_Write(subsystem, level, __VA_ARGS__);       \
+    } while(0)
+
+#define LOG_DEBUG(subsystem, ...)   LOG(subsystem, LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(subsystem, ...)    LOG(subsystem, LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(subsystem, ...)    LOG(subsystem, LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(subsystem, ...)   LOG(subsystem, LOG_LEVEL_ERROR, __VA_ARGS__)
@@ -3,10 +3,14 @@
 #include <arch/i686/interrupts/idt.h>
 #include <arch/i686/interrupts/isr.h>
 #include <arch/i686/interrupts/irq.h>
+#include <arch/i686/fpu/fpu.h>
+#include <arch/i686/smp/smp.h>
 
 void HAL_Inizialize(){
     i686_GDT_Initialize();
+    i686_SMP_InitializeBoot();
     i686_IDT_Initialize();
     i686_ISR_Initialize();
+    i686_FPU_Initialize();
     i686_IRQ_Initialize();
 }
\ No newline at end of file
@@ -2,34 +2,67 @@
 #include <hal/hal.h>
 #include <arch/i686/io.h>
 #include <arch/i686/interrupts/irq.h>
+#include <arch/i686/smp/smp.h>
 #include <arch/generic/cpu.h>
+#include <boot/timeline.h>
+#include <mm/pmm.h>
+#include <mm/vmm.h>
+#include <mm/slab.h>
+#include <time/clock.h>
+#include <time/timer.h>
+#include <sched/sched.h>
+#include <sched/work.h>
 
 #include "stdio.h"
 #include "memory.h"
 
-void timer(Registers* regs){
-}
-
 extern uint8_t __bss_start;
 extern uint8_t __end;
 
-void __attribute__((section(".entry"))) start(uint16_t bootDrive){
+void __attribute__((section(".entry"))) start(BootInfo* bootInfo){
 
     memset(&__bss_start, 0, (&__end) - (&__bss_start));
 
+    BOOT_TimelineInitialize(bootInfo);
+    BOOT_Checkpoint(BOOT_PHASE_KERNEL_ENTRY);
+
     clrscr();
     printf("Loaded Kernel !!!\r\n");
 
     HAL_Inizialize();
+    BOOT_Checkpoint(BOOT_PHASE_HAL_INIT);
 
     printf("Initialized HAL !!!\r\n");
 
-    i686_IRQ_RegisterHandler(0, timer);
+    CLOCK_Initialize();
+    TIMER_Initialize();
+
+    if(PMM_Initialize(bootInfo))
+        PMM_PrintStats();
+    BOOT_Checkpoint(BOOT_PHASE_PMM_INIT);
+
+    VMM_Initialize(bootInfo);
+    SLAB_Initialize();
+
+    MEMORY_Initialize();
+    MEMORY_Benchmark();
+    i686_IRQ_Benchmark();
+
+    i686_SMP_Initialize();
+    WORK_Initialize();
+    WORK_Benchmark();
+    SLAB_Benchmark();
+    VMM_Benchmark();
+
+    SCHED_Initialize();
+    SCHED_Benchmark();
 
     print_cpu_info();
+    BOOT_Checkpoint(BOOT_PHASE_CPU_INFO);
 
+    BOOT_PrintTimeline();
 
-    end:
-        for(;;);
+    // nothing left for the boot thread, the idle thread takes over
+    SCHED_Exit();
 
 }
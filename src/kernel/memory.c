@@ -1,30 +1,200 @@
 #include "memory.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <arch/generic/cpu.h>
+#include <arch/i686/io.h>
+#include <arch/i686/fpu/fpu.h>
+#include <mm/pmm.h>
+#include <util/arrays.h>
 
-void * memcpy(void * dst, const void * src, uint16_t num){
-    uint8_t* u8Dst = (uint8_t *)dst;
-    const uint8_t* u8Src = (const uint8_t *)src;
+typedef void* (*MEMORY_MemcpyFunc)(void* dst, const void* src, size_t num);
+typedef void* (*MEMORY_MemsetFunc)(void* ptr, int value, size_t num);
+typedef int (*MEMORY_MemcmpFunc)(const void* ptr1, const void* ptr2, size_t num);
 
-    for (uint16_t i = 0; i < num; i++)
-        u8Dst[i] = u8Src[i];
+// memory_asm.asm
+void* __attribute__((cdecl)) MEMORY_MemcpyMovsd(void* dst, const void* src, size_t num);
+void* __attribute__((cdecl)) MEMORY_MemcpyErms(void* dst, const void* src, size_t num);
+void* __attribute__((cdecl)) MEMORY_MemcpySse2(void* dst, const void* src, size_t num);
+void* __attribute__((cdecl)) MEMORY_MemsetStosd(void* ptr, int value, size_t num);
+void* __attribute__((cdecl)) MEMORY_MemsetErms(void* ptr, int value, size_t num);
+void* __attribute__((cdecl)) MEMORY_MemsetSse2(void* ptr, int value, size_t num);
+int __attribute__((cdecl)) MEMORY_MemcmpDword(const void* ptr1, const void* ptr2, size_t num);
+int __attribute__((cdecl)) MEMORY_MemcmpSse2(const void* ptr1, const void* ptr2, size_t num);
 
+// Borrowing the SSE registers costs a CR0 write or two (plus an FPU save if someone owns them),
+// below this the rep movsd/stosd versions win anyway
+#define MEMORY_SIMD_THRESHOLD   512
+
+static void* MEMORY_MemcpySimd(void* dst, const void* src, size_t num){
+    if(num < MEMORY_SIMD_THRESHOLD)
+        return MEMORY_MemcpyMovsd(dst, src, num);
+
+    uint32_t flags = i686_FPU_KernelBegin();
+    MEMORY_MemcpySse2(dst, src, num);
+    i686_FPU_KernelEnd(flags);
     return dst;
 }
 
-void * memset(void * ptr, int value, uint16_t num){
-    uint8_t * u8Ptr = (uint8_t *)ptr;
-
-    for(uint16_t i = 0; i < num; i++)
-        u8Ptr[i] = (uint8_t)value;
+static void* MEMORY_MemsetSimd(void* ptr, int value, size_t num){
+    if(num < MEMORY_SIMD_THRESHOLD)
+        return MEMORY_MemsetStosd(ptr, value, num);
 
+    uint32_t flags = i686_FPU_KernelBegin();
+    MEMORY_MemsetSse2(ptr, value, num);
+    i686_FPU_KernelEnd(flags);
     return ptr;
 }
-int memcmp(const void * ptr1, const void * ptr2, uint16_t num){
-    const uint8_t* u8Ptr1 = (const uint8_t *)ptr1;
-    const uint8_t* u8Ptr2 = (const uint8_t *)ptr2;
 
-    for (uint16_t i = 0; i < num; i++)
-        if (u8Ptr1[i] != u8Ptr2[i])
-            return 1;
+static int MEMORY_MemcmpSimd(const void* ptr1, const void* ptr2, size_t num){
+    if(num < MEMORY_SIMD_THRESHOLD)
+        return MEMORY_MemcmpDword(ptr1, ptr2, num);
+
+    uint32_t flags = i686_FPU_KernelBegin();
+    int result = MEMORY_MemcmpSse2(ptr1, ptr2, num);
+    i686_FPU_KernelEnd(flags);
+    return result;
+}
+
+enum {
+    MEMORY_FEATURE_ERMSB    = 1 << 0,
+    MEMORY_FEATURE_SSE2     = 1 << 1,
+};
+
+typedef struct {
+    const char*         Name;
+    uint32_t            Features;       // Everything the variant needs
+    MEMORY_MemcpyFunc   Memcpy;
+    MEMORY_MemsetFunc   Memset;
+    MEMORY_MemcmpFunc   Memcmp;         // NULL if the variant has nothing better than the others
+} MEMORY_Variant;
+
+// In order of preference, the last supported one wins
+static const MEMORY_Variant g_Variants[] = {
+    { "rep movsd",  0,                      MEMORY_MemcpyMovsd, MEMORY_MemsetStosd, MEMORY_MemcmpDword },
+    { "sse2",       MEMORY_FEATURE_SSE2,    MEMORY_MemcpySimd,  MEMORY_MemsetSimd,  MEMORY_MemcmpSimd },
+    { "ermsb",      MEMORY_FEATURE_ERMSB,   MEMORY_MemcpyErms,  MEMORY_MemsetErms,  NULL },
+};
+
+// Usable before MEMORY_Initialize: the .bss clear and the compiler's own struct copies land here
+static MEMORY_MemcpyFunc g_Memcpy = MEMORY_MemcpyMovsd;
+static MEMORY_MemsetFunc g_Memset = MEMORY_MemsetStosd;
+static MEMORY_MemcmpFunc g_Memcmp = MEMORY_MemcmpDword;
+static uint32_t g_Features;
+
+// Defined here, so the generic libk versions are never pulled in by the linker
+void * memcpy(void * dst, const void * src, size_t num){
+    return g_Memcpy(dst, src, num);
+}
+
+void * memset(void * ptr, int value, size_t num){
+    return g_Memset(ptr, value, num);
+}
+
+int memcmp(const void * ptr1, const void * ptr2, size_t num){
+    return g_Memcmp(ptr1, ptr2, num);
+}
+
+static uint32_t MEMORY_DetectFeatures(){
+    unsigned int eax, ebx, ecx, edx;
+    uint32_t features = 0;
+
+    if(__get_cpuid(1, &eax, &ebx, &ecx, &edx)){
+        uint32_t sse = CPUID_FEAT_EDX_FXSR | CPUID_FEAT_EDX_SSE | CPUID_FEAT_EDX_SSE2;
+        // i686_FPU_Initialize sets CR4.OSFXSR
+        if((edx & sse) == sse && i686_FPU_SSEEnabled())
+            features |= MEMORY_FEATURE_SSE2;
+    }
+
+    if(__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & CPUID_FEAT_7_EBX_ERMSB))
+        features |= MEMORY_FEATURE_ERMSB;
+
+    return features;
+}
+
+void MEMORY_Initialize(){
+    g_Features = MEMORY_DetectFeatures();
+
+    const char* memcpyName = NULL;
+    const char* memcmpName = NULL;
+    for(int i = 0; i < SIZE(g_Variants); i++){
+        const MEMORY_Variant* variant = &g_Variants[i];
+        if((variant->Features & g_Features) != variant->Features)
+            continue;
+
+        g_Memcpy = variant->Memcpy;
+        g_Memset = variant->Memset;
+        memcpyName = variant->Name;
+        if(variant->Memcmp != NULL){
+            g_Memcmp = variant->Memcmp;
+            memcmpName = variant->Name;
+        }
+    }
+
+    printf("[MEM] memcpy/memset: %s, memcmp: %s\r\n", memcpyName, memcmpName);
+}
+
+// Prints x / y with two decimals
+static void MEMORY_PrintRatio(uint64_t x, uint64_t y){
+    uint32_t hundredths = y != 0 ? (uint32_t)(x * 100 / y) : 0;
+    printf(" %d.%d%d", hundredths / 100, (hundredths / 10) % 10, hundredths % 10);
+}
+
+#define BENCH_BUFFER_ORDER  8                                       // 1 MiB
+#define BENCH_BUFFER_SIZE   (PAGE_SIZE << BENCH_BUFFER_ORDER)
+#define BENCH_BYTES         (4 * BENCH_BUFFER_SIZE)                 // moved per size class
+
+static const uint32_t g_BenchSizes[] = { 64, 4096, 65536, BENCH_BUFFER_SIZE };
 
-    return 0;
-}
\ No newline at end of file
+void MEMORY_Benchmark(){
+    uint32_t src = PMM_AllocPages(BENCH_BUFFER_ORDER);
+    uint32_t dst = PMM_AllocPages(BENCH_BUFFER_ORDER);
+    if(src == 0 || dst == 0){
+        printf("[MEM] Not enough memory for the benchmark\r\n");
+        if(src != 0) PMM_FreePages(src, BENCH_BUFFER_ORDER);
+        if(dst != 0) PMM_FreePages(dst, BENCH_BUFFER_ORDER);
+        return;
+    }
+
+    MEMORY_MemsetStosd((void*)src, 0x5A, BENCH_BUFFER_SIZE);
+    MEMORY_MemsetStosd((void*)dst, 0x5A, BENCH_BUFFER_SIZE);
+
+    printf("[MEM] bytes/cycle for");
+    for(int i = 0; i < SIZE(g_BenchSizes); i++)
+        printf(" %d", g_BenchSizes[i]);
+    printf(" bytes\r\n");
+
+    for(int i = 0; i < SIZE(g_Variants); i++){
+        const MEMORY_Variant* variant = &g_Variants[i];
+        if((variant->Features & g_Features) != variant->Features){
+            printf("[MEM] %s: not supported\r\n", variant->Name);
+            continue;
+        }
+
+        for(int op = 0; op < 3; op++){
+            if(op == 2 && variant->Memcmp == NULL)
+                continue;
+
+            printf("[MEM] %s %s:", variant->Name, op == 0 ? "memcpy" : op == 1 ? "memset" : "memcmp");
+            for(int j = 0; j < SIZE(g_BenchSizes); j++){
+                uint32_t size = g_BenchSizes[j];
+                uint32_t iterations = BENCH_BYTES / size;
+
+                uint64_t start = i686_rdtsc();
+                for(uint32_t k = 0; k < iterations; k++){
+                    switch(op){
+                        case 0: variant->Memcpy((void*)dst, (const void*)src, size); break;
+                        case 1: variant->Memset((void*)dst, 0x5A, size); break;
+                        case 2: variant->Memcmp((const void*)dst, (const void*)src, size); break;
+                    }
+                }
+                uint64_t cycles = i686_rdtsc() - start;
+
+                MEMORY_PrintRatio((uint64_t)iterations * size, cycles);
+            }
+            printf("\r\n");
+        }
+    }
+
+    PMM_FreePages(src, BENCH_BUFFER_ORDER);
+    PMM_FreePages(dst, BENCH_BUFFER_ORDER);
+}
@@ -1,6 +1,8 @@
 #pragma once
 #include <stdint.h>
+#include <stddef.h>
+#include <libk/memory.h>
 
-void * memcpy( void * dst, const void * src, uint16_t num);
-void * memset(void * ptr, int value, uint16_t num);
-int memcmp(const void * ptr1, const void * ptr2, uint16_t num);
\ No newline at end of file
+// Picks the fastest memcpy/memset/memcmp the CPU supports, until then the rep movsd/stosd versions are used
+void MEMORY_Initialize();
+void MEMORY_Benchmark();
@@ -0,0 +1,283 @@
+; Variants of memcpy/memset/memcmp, memory.c picks one of them at boot.
+; All of them expect the direction flag to be clear, as cdecl guarantees.
+
+; void* _cdecl MEMORY_MemcpyMovsd(void* dst, const void* src, size_t num);
+
+global MEMORY_MemcpyMovsd
+MEMORY_MemcpyMovsd:
+    [bits 32]
+    push esi
+    push edi
+
+    mov edi, [esp + 12]
+    mov esi, [esp + 16]
+    mov ecx, [esp + 20]
+    mov eax, edi
+
+    mov edx, ecx
+    shr ecx, 2
+    rep movsd
+    mov ecx, edx
+    and ecx, 3
+    rep movsb
+
+    pop edi
+    pop esi
+    ret
+
+; void* _cdecl MEMORY_MemcpyErms(void* dst, const void* src, size_t num);
+
+global MEMORY_MemcpyErms
+MEMORY_MemcpyErms:
+    [bits 32]
+    push esi
+    push edi
+
+    mov edi, [esp + 12]
+    mov esi, [esp + 16]
+    mov ecx, [esp + 20]
+    mov eax, edi
+
+    rep movsb
+
+    pop edi
+    pop esi
+    ret
+
+; void* _cdecl MEMORY_MemcpySse2(void* dst, const void* src, size_t num);
+
+global MEMORY_MemcpySse2
+MEMORY_MemcpySse2:
+    [bits 32]
+    push esi
+    push edi
+
+    mov edi, [esp + 12]
+    mov esi, [esp + 16]
+    mov ecx, [esp + 20]
+    mov eax, edi
+
+    cmp ecx, 64
+    jb .tail
+
+    ; copy up to 15 bytes so the stores are aligned
+    mov edx, edi
+    neg edx
+    and edx, 15
+    sub ecx, edx
+    xchg ecx, edx
+    rep movsb
+
+    ; edx - 64 byte blocks, ecx - tail
+    mov ecx, edx
+    shr edx, 6
+    and ecx, 63
+    test edx, edx
+    jz .tail
+
+.loop:
+    movdqu xmm0, [esi]
+    movdqu xmm1, [esi + 16]
+    movdqu xmm2, [esi + 32]
+    movdqu xmm3, [esi + 48]
+    movdqa [edi], xmm0
+    movdqa [edi + 16], xmm1
+    movdqa [edi + 32], xmm2
+    movdqa [edi + 48], xmm3
+    add esi, 64
+    add edi, 64
+    dec edx
+    jnz .loop
+
+.tail:
+    rep movsb
+
+    pop edi
+    pop esi
+    ret
+
+; void* _cdecl MEMORY_MemsetStosd(void* ptr, int value, size_t num);
+
+global MEMORY_MemsetStosd
+MEMORY_MemsetStosd:
+    [bits 32]
+    push edi
+
+    mov edi, [esp + 8]
+    movzx eax, byte [esp + 12]
+    mov ecx, [esp + 16]
+
+    ; replicate the byte in all of eax
+    mov edx, 01010101h
+    imul eax, edx
+
+    mov edx, ecx
+    shr ecx, 2
+    rep stosd
+    mov ecx, edx
+    and ecx, 3
+    rep stosb
+
+    mov eax, [esp + 8]
+    pop edi
+    ret
+
+; void* _cdecl MEMORY_MemsetErms(void* ptr, int value, size_t num);
+
+global MEMORY_MemsetErms
+MEMORY_MemsetErms:
+    [bits 32]
+    push edi
+
+    mov edi, [esp + 8]
+    mov al, [esp + 12]
+    mov ecx, [esp + 16]
+
+    rep stosb
+
+    mov eax, [esp + 8]
+    pop edi
+    ret
+
+; void* _cdecl MEMORY_MemsetSse2(void* ptr, int value, size_t num);
+
+global MEMORY_MemsetSse2
+MEMORY_MemsetSse2:
+    [bits 32]
+    push edi
+
+    mov edi, [esp + 8]
+    movzx eax, byte [esp + 12]
+    mov ecx, [esp + 16]
+
+    mov edx, 01010101h
+    imul eax, edx
+
+    cmp ecx, 64
+    jb .tail
+
+    ; align the stores
+    mov edx, edi
+    neg edx
+    and edx, 15
+    sub ecx, edx
+    xchg ecx, edx
+    rep stosb
+
+    movd xmm0, eax
+    pshufd xmm0, xmm0, 0
+
+    mov ecx, edx
+    shr edx, 6
+    and ecx, 63
+    test edx, edx
+    jz .tail
+
+.loop:
+    movdqa [edi], xmm0
+    movdqa [edi + 16], xmm0
+    movdqa [edi + 32], xmm0
+    movdqa [edi + 48], xmm0
+    add edi, 64
+    dec edx
+    jnz .loop
+
+.tail:
+    rep stosb
+
+    mov eax, [esp + 8]
+    pop edi
+    ret
+
+; int _cdecl MEMORY_MemcmpDword(const void* ptr1, const void* ptr2, size_t num);
+
+global MEMORY_MemcmpDword
+MEMORY_MemcmpDword:
+    [bits 32]
+    push esi
+    push edi
+
+    mov esi, [esp + 12]
+    mov edi, [esp + 16]
+    mov ecx, [esp + 20]
+
+    mov edx, ecx
+    shr ecx, 2
+    cmp ecx, ecx            ; ZF=1, repe leaves the flags alone when ecx is 0
+    repe cmpsd
+    jne .dword_differs
+
+    mov ecx, edx
+    and ecx, 3
+    jmp .bytes
+
+.dword_differs:
+    ; go back and find the byte inside the dword
+    sub esi, 4
+    sub edi, 4
+    mov ecx, 4
+
+.bytes:
+    xor eax, eax            ; also ZF=1
+    repe cmpsb
+    je .done
+
+    movzx eax, byte [esi - 1]
+    movzx edx, byte [edi - 1]
+    sub eax, edx
+
+.done:
+    pop edi
+    pop esi
+    ret
+
+; int _cdecl MEMORY_MemcmpSse2(const void* ptr1, const void* ptr2, size_t num);
+
+global MEMORY_MemcmpSse2
+MEMORY_MemcmpSse2:
+    [bits 32]
+    push esi
+    push edi
+
+    mov esi, [esp + 12]
+    mov edi, [esp + 16]
+    mov ecx, [esp + 20]
+
+.loop:
+    cmp ecx, 16
+    jb .bytes
+
+    movdqu xmm0, [esi]
+    movdqu xmm1, [edi]
+    pcmpeqb xmm0, xmm1
+    pmovmskb eax, xmm0
+    cmp eax, 0FFFFh
+    jne .differs
+
+    add esi, 16
+    add edi, 16
+    sub ecx, 16
+    jmp .loop
+
+.differs:
+    ; first clear bit of the mask is the first differing byte
+    not eax
+    bsf eax, eax
+    movzx edx, byte [edi + eax]
+    movzx eax, byte [esi + eax]
+    sub eax, edx
+    jmp .done
+
+.bytes:
+    xor eax, eax
+    repe cmpsb
+    je .done
+
+    movzx eax, byte [esi - 1]
+    movzx edx, byte [edi - 1]
+    sub eax, edx
+
+.done:
+    pop edi
+    pop esi
+    ret
@@ -0,0 +1,323 @@
+#include "pmm.h"
+#include <stdio.h>
+#include <debug/log.h>
+#include <sched/spinlock.h>
+#include <stddef.h>
+
+// Binary buddy allocator over the physical frames.
+// Free blocks are kept on per-order doubly linked lists whose nodes live in the free frames themselves,
+// and a bitmap per order tells if a block is free, so the buddy lookup on free doesn't walk any list.
+
+#define PMM_LOW_MEMORY_END  0x00100000      // Below 1 MiB: BIOS, stage2 and the boot info, never handed out
+#define PMM_MEMORY_LIMIT    0x100000000ULL  // No PAE, physical memory above 4 GiB is unreachable
+#define PMM_MAX_HOLES       (2 * BOOT_MAX_MEMORY_REGIONS + 2)
+
+typedef struct PMM_FreeBlock {
+    struct PMM_FreeBlock* Next;
+    struct PMM_FreeBlock* Prev;
+} PMM_FreeBlock;
+
+typedef struct {
+    uint64_t Begin;
+    uint64_t End;
+} PMM_Range;
+
+typedef struct {
+    PMM_FreeBlock* FreeLists[PMM_ORDER_COUNT];
+    uint32_t*      FreeMaps[PMM_ORDER_COUNT];  // Bit set - the block of this order at this index is free
+    uint32_t       FrameCount;                  // Frames covered by the bitmaps
+
+    PMM_Range      Holes[PMM_MAX_HOLES];        // Ranges that can't be handed to the allocator during init
+    uint32_t       HoleCount;
+
+    PMM_Stats      Stats;
+} PMM_Data;
+
+static PMM_Data g_Pmm;
+static Spinlock g_PmmLock = SPINLOCK_INIT;
+
+extern uint8_t __end;
+
+static const char* const g_RegionTypeNames[] = {
+    [MEMORY_REGION_USABLE]              = "usable",
+    [MEMORY_REGION_RESERVED]            = "reserved",
+    [MEMORY_REGION_ACPI_RECLAIMABLE]    = "ACPI reclaimable",
+    [MEMORY_REGION_ACPI_NVS]            = "ACPI NVS",
+    [MEMORY_REGION_BAD]                 = "bad",
+};
+
+static uint32_t PMM_MapWords(uint8_t order){
+    uint32_t blocks = (g_Pmm.FrameCount + (1u << order) - 1) >> order;
+    return (blocks + 31) / 32;
+}
+
+static bool PMM_IsFree(uint32_t frame, uint8_t order){
+    uint32_t index = frame >> order;
+    return (g_Pmm.FreeMaps[order][index / 32] & (1u << (index % 32))) != 0;
+}
+
+static void PMM_PushBlock(uint32_t frame, uint8_t order){
+    PMM_FreeBlock* block = (PMM_FreeBlock*)(frame << PAGE_SHIFT);
+    block->Prev = NULL;
+    block->Next = g_Pmm.FreeLists[order];
+    if(block->Next != NULL)
+        block->Next->Prev = block;
+    g_Pmm.FreeLists[order] = block;
+
+    uint32_t index = frame >> order;
+    g_Pmm.FreeMaps[order][index / 32] |= 1u << (index % 32);
+    g_Pmm.Stats.FreeBlocks[order]++;
+    g_Pmm.Stats.FreeFrames += 1u << order;
+}
+
+static void PMM_RemoveBlock(uint32_t frame, uint8_t order){
+    PMM_FreeBlock* block = (PMM_FreeBlock*)(frame << PAGE_SHIFT);
+    if(block->Prev != NULL)
+        block->Prev->Next = block->Next;
+    else
+        g_Pmm.FreeLists[order] = block->Next;
+    if(block->Next != NULL)
+        block->Next->Prev = block->Prev;
+
+    uint32_t index = frame >> order;
+    g_Pmm.FreeMaps[order][index / 32] &= ~(1u << (index % 32));
+    g_Pmm.Stats.FreeBlocks[order]--;
+    g_Pmm.Stats.FreeFrames -= 1u << order;
+}
+
+// Gives a block back, merging it with its buddy for as long as the buddy is free too
+static void PMM_ReleaseBlock(uint32_t frame, uint8_t order){
+    while(order < PMM_MAX_ORDER){
+        uint32_t buddy = frame ^ (1u << order);
+        if(buddy >= g_Pmm.FrameCount || !PMM_IsFree(buddy, order))
+            break;
+
+        PMM_RemoveBlock(buddy, order);
+        frame &= ~(1u << order);
+        order++;
+        g_Pmm.Stats.Merges++;
+    }
+
+    PMM_PushBlock(frame, order);
+}
+
+static uint32_t PMM_AllocPagesLocked(uint8_t order){
+    if(order > PMM_MAX_ORDER)
+        return 0;
+
+    uint8_t current = order;
+    while(current <= PMM_MAX_ORDER && g_Pmm.FreeLists[current] == NULL)
+        current++;
+
+    if(current > PMM_MAX_ORDER)
+        return 0;
+
+    uint32_t frame = (uint32_t)g_Pmm.FreeLists[current] >> PAGE_SHIFT;
+    PMM_RemoveBlock(frame, current);
+
+    // keep the lower half, give the upper halves back
+    while(current > order){
+        current--;
+        PMM_PushBlock(frame + (1u << current), current);
+        g_Pmm.Stats.Splits++;
+    }
+
+    g_Pmm.Stats.Allocations++;
+    return frame << PAGE_SHIFT;
+}
+
+static void PMM_FreePagesLocked(uint32_t address, uint8_t order){
+    uint32_t frame = address >> PAGE_SHIFT;
+    if(order > PMM_MAX_ORDER
+        || (address & (PAGE_SIZE - 1)) != 0
+        || (frame & ((1u << order) - 1)) != 0
+        || frame >= g_Pmm.FrameCount){
+        LOG_ERROR(LOG_MEMORY, "Invalid free of 0x%x (order %d)", address, order);
+        return;
+    }
+
+    // after merging the frame may sit inside a larger free block
+    for(uint8_t containing = order; containing <= PMM_MAX_ORDER; containing++){
+        if(PMM_IsFree(frame & ~((1u << containing) - 1), containing)){
+            LOG_ERROR(LOG_MEMORY, "Double free of 0x%x (order %d)", address, order);
+            return;
+        }
+    }
+
+    PMM_ReleaseBlock(frame, order);
+    g_Pmm.Stats.Frees++;
+}
+
+// Threads, interrupt handlers and other CPUs can all allocate, the free lists are only touched under the lock
+uint32_t PMM_AllocPages(uint8_t order){
+    uint32_t flags = SPINLOCK_Acquire(&g_PmmLock);
+    uint32_t address = PMM_AllocPagesLocked(order);
+    SPINLOCK_Release(&g_PmmLock, flags);
+    return address;
+}
+
+void PMM_FreePages(uint32_t address, uint8_t order){
+    uint32_t flags = SPINLOCK_Acquire(&g_PmmLock);
+    PMM_FreePagesLocked(address, order);
+    SPINLOCK_Release(&g_PmmLock, flags);
+}
+
+static void PMM_AddHole(uint64_t begin, uint64_t end){
+    if(begin >= end || g_Pmm.HoleCount >= PMM_MAX_HOLES)
+        return;
+
+    g_Pmm.Holes[g_Pmm.HoleCount].Begin = begin;
+    g_Pmm.Holes[g_Pmm.HoleCount].End = end;
+    g_Pmm.HoleCount++;
+}
+
+static bool PMM_OverlapsHole(uint64_t begin, uint64_t end){
+    for(uint32_t i = 0; i < g_Pmm.HoleCount; i++){
+        if(g_Pmm.Holes[i].Begin < end && begin < g_Pmm.Holes[i].End)
+            return true;
+    }
+    return false;
+}
+
+// Frees [begin, end) minus every hole from 'hole' onward, in the largest aligned blocks that fit
+static void PMM_AddRange(uint64_t begin, uint64_t end, uint32_t hole){
+    for(; hole < g_Pmm.HoleCount; hole++){
+        const PMM_Range* range = &g_Pmm.Holes[hole];
+        if(range->Begin >= end || begin >= range->End)
+            continue;
+
+        if(range->Begin > begin)
+            PMM_AddRange(begin, range->Begin, hole + 1);
+
+        begin = range->End;
+        if(begin >= end)
+            return;
+    }
+
+    uint32_t frame = (uint32_t)((begin + PAGE_SIZE - 1) >> PAGE_SHIFT);
+    uint32_t last = (uint32_t)(end >> PAGE_SHIFT);
+    while(frame < last){
+        uint8_t order = 0;
+        while(order < PMM_MAX_ORDER
+              && (frame & ((2u << order) - 1)) == 0
+              && frame + (2u << order) <= last)
+            order++;
+
+        PMM_ReleaseBlock(frame, order);
+        g_Pmm.Stats.TotalFrames += 1u << order;
+        frame += 1u << order;
+    }
+}
+
+static bool PMM_IsUsable(const MemoryRegion* region){
+    return region->Type == MEMORY_REGION_USABLE && region->Begin < PMM_MEMORY_LIMIT;
+}
+
+static uint64_t PMM_RegionEnd(const MemoryRegion* region){
+    uint64_t end = region->Begin + region->Length;
+    return end > PMM_MEMORY_LIMIT ? PMM_MEMORY_LIMIT : end;
+}
+
+bool PMM_Initialize(const BootInfo* bootInfo){
+    if(bootInfo == NULL || bootInfo->Magic != BOOT_INFO_MAGIC || bootInfo->MemoryRegionCount == 0){
+        printf("[PMM] No memory map from the bootloader!\r\n");
+        return false;
+    }
+
+    const MemoryRegion* regions = bootInfo->MemoryRegions;
+    uint32_t regionCount = bootInfo->MemoryRegionCount;
+
+    // everything below the end of the kernel image, and whatever the BIOS doesn't call usable
+    uint64_t kernelEnd = ((uint32_t)&__end + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    PMM_AddHole(0, kernelEnd > PMM_LOW_MEMORY_END ? kernelEnd : PMM_LOW_MEMORY_END);
+
+    uint64_t highest = 0;
+    for(uint32_t i = 0; i < regionCount; i++){
+        const MemoryRegion* region = &regions[i];
+        const char* type = region->Type < sizeof(g_RegionTypeNames) / sizeof(g_RegionTypeNames[0]) && g_RegionTypeNames[region->Type] != NULL
+                            ? g_RegionTypeNames[region->Type] : "unknown";
+        LOG_DEBUG(LOG_MEMORY, "0x%llx - 0x%llx %s", region->Begin, region->Begin + region->Length, type);
+
+        if(!PMM_IsUsable(region)){
+            PMM_AddHole(region->Begin, region->Begin + region->Length);
+            continue;
+        }
+
+        if(PMM_RegionEnd(region) > highest)
+            highest = PMM_RegionEnd(region);
+    }
+
+    g_Pmm.FrameCount = (uint32_t)(highest >> PAGE_SHIFT);
+
+    // the bitmaps go in the first usable spot after the kernel that is big enough
+    uint32_t mapBytes = 0;
+    for(uint8_t order = 0; order <= PMM_MAX_ORDER; order++)
+        mapBytes += PMM_MapWords(order) * sizeof(uint32_t);
+
+    uint64_t mapBegin = 0;
+    for(uint32_t i = 0; i < regionCount && mapBegin == 0; i++){
+        if(!PMM_IsUsable(&regions[i]))
+            continue;
+
+        uint64_t begin = (regions[i].Begin + PAGE_SIZE - 1) & ~(uint64_t)(PAGE_SIZE - 1);
+        if(begin < kernelEnd)
+            begin = kernelEnd;
+
+        if(begin + mapBytes <= PMM_RegionEnd(&regions[i]) && !PMM_OverlapsHole(begin, begin + mapBytes))
+            mapBegin = begin;
+    }
+
+    if(mapBegin == 0){
+        printf("[PMM] No room for %d bytes of allocator bitmaps!\r\n", mapBytes);
+        return false;
+    }
+
+    uint32_t* map = (uint32_t*)(uint32_t)mapBegin;
+    for(uint8_t order = 0; order <= PMM_MAX_ORDER; order++){
+        uint32_t words = PMM_MapWords(order);
+        g_Pmm.FreeMaps[order] = map;
+        for(uint32_t i = 0; i < words; i++)
+            map[i] = 0;
+        map += words;
+    }
+    PMM_AddHole(mapBegin, mapBegin + mapBytes);
+
+    // usable regions become holes once added, so overlapping entries aren't freed twice
+    for(uint32_t i = 0; i < regionCount; i++){
+        if(!PMM_IsUsable(&regions[i]))
+            continue;
+
+        PMM_AddRange(regions[i].Begin, PMM_RegionEnd(&regions[i]), 0);
+        PMM_AddHole(regions[i].Begin, PMM_RegionEnd(&regions[i]));
+    }
+
+    return true;
+}
+
+void PMM_GetStats(PMM_Stats* statsOut){
+    *statsOut = g_Pmm.Stats;
+}
+
+void PMM_PrintStats(){
+    const PMM_Stats* stats = &g_Pmm.Stats;
+
+    printf("[PMM] %d KiB free of %d KiB\r\n", stats->FreeFrames * (PAGE_SIZE / 1024), stats->TotalFrames * (PAGE_SIZE / 1024));
+    printf("[PMM] %d allocations, %d frees, %d splits, %d merges\r\n", stats->Allocations, stats->Frees, stats->Splits, stats->Merges);
+
+    int largest = -1;
+    for(uint8_t order = 0; order <= PMM_MAX_ORDER; order++){
+        if(stats->FreeBlocks[order] == 0)
+            continue;
+
+        printf("[PMM]   order %d (%d KiB): %d free blocks\r\n", order, (PAGE_SIZE / 1024) << order, stats->FreeBlocks[order]);
+        largest = order;
+    }
+
+    // share of the free memory that can't satisfy a request of the largest order
+    if(stats->FreeFrames != 0){
+        uint32_t maxOrderFrames = stats->FreeBlocks[PMM_MAX_ORDER] << PMM_MAX_ORDER;
+        uint32_t fragmented = stats->FreeFrames - maxOrderFrames;
+        printf("[PMM] Largest free block: order %d, fragmentation: %d%%\r\n",
+               largest, (uint32_t)((uint64_t)fragmented * 100 / stats->FreeFrames));
+    }
+}
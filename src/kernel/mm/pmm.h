@@ -0,0 +1,30 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <boot/bootinfo.h>
+
+#define PAGE_SIZE       4096
+#define PAGE_SHIFT      12
+
+// Largest block handed out by the allocator: 2^10 frames = 4 MiB
+#define PMM_MAX_ORDER   10
+#define PMM_ORDER_COUNT (PMM_MAX_ORDER + 1)
+
+typedef struct {
+    uint32_t TotalFrames;                   // Frames handed to the allocator at boot
+    uint32_t FreeFrames;
+    uint32_t FreeBlocks[PMM_ORDER_COUNT];   // Free blocks of each order
+    uint32_t Allocations;
+    uint32_t Frees;
+    uint32_t Splits;
+    uint32_t Merges;
+} PMM_Stats;
+
+bool PMM_Initialize(const BootInfo* bootInfo);
+
+// Returns the physical address of 2^order contiguous frames aligned to their size, 0 if there are none left
+uint32_t PMM_AllocPages(uint8_t order);
+void PMM_FreePages(uint32_t address, uint8_t order);
+
+void PMM_GetStats(PMM_Stats* statsOut);
+void PMM_PrintStats();
@@ -0,0 +1,395 @@
+#include <mm/slab.h>
+#include <mm/pmm.h>
+#include <arch/i686/smp/smp.h>
+#include <arch/i686/io.h>
+#include <sched/spinlock.h>
+#include <debug/log.h>
+#include <time/clock.h>
+#include <stdio.h>
+
+// Slabs are PMM blocks aligned to their size, so the slab header of an object is found by masking
+// its address. kmalloc blocks too big for a size class start with the same header, without a cache.
+
+#define SLAB_ORDER              2                                   // 16 KiB
+#define SLAB_SIZE               (PAGE_SIZE << SLAB_ORDER)
+#define SLAB_MAGIC              0x51AB51AB
+
+#define SLAB_MAGAZINE_SIZE      13                                  // Fills a cache line with the counters
+#define SLAB_REFILL_COUNT       ((SLAB_MAGAZINE_SIZE + 1) / 2)
+
+#define KMALLOC_MIN_SHIFT       3                                   // 8 bytes
+#define KMALLOC_MAX_SHIFT       11                                  // 2048 bytes
+#define KMALLOC_CLASSES         (KMALLOC_MAX_SHIFT - KMALLOC_MIN_SHIFT + 1)
+
+#define SLAB_BENCHMARK_OBJECTS  64
+#define SLAB_BENCHMARK_ROUNDS   1000
+
+typedef struct Slab Slab;
+
+struct Slab{
+    uint32_t    Magic;
+    SlabCache*  Cache;                  // NULL for a kmalloc block of its own
+    uint8_t     Order;                  // Of the PMM block
+    Slab*       Next;
+    Slab*       Prev;
+    void*       FreeList;               // First word of a free object points to the next one
+    uint32_t    InUse;                  // Objects not on FreeList
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+typedef struct {
+    uint32_t    Count;
+    uint32_t    Allocations;
+    uint32_t    Refills;
+    void*       Objects[SLAB_MAGAZINE_SIZE];
+} __attribute__((aligned(CACHE_LINE_SIZE))) SlabMagazine;
+
+_Static_assert(sizeof(SlabMagazine) == CACHE_LINE_SIZE, "one magazine per cache line");
+
+struct SlabCache{
+    const char*     Name;
+    uint32_t        ObjectSize;
+    uint32_t        FirstObject;        // Offset in the slab, after the header
+    uint32_t        ObjectsPerSlab;
+
+    Spinlock        Lock;               // Everything below, the magazines are per CPU
+    Slab*           Partial;            // Some objects free
+    Slab*           Full;
+    Slab*           Empty;              // At most one kept for reuse
+    uint32_t        SlabCount;
+    uint32_t        InUse;              // Objects taken out of the slabs, magazines included
+    SlabCache*      NextCache;
+
+    SlabMagazine    Magazines[SMP_MAX_CPUS];
+};
+
+// The caches themselves come from this one
+static SlabCache g_CacheCache;
+static SlabCache* g_Caches = NULL;
+static Spinlock g_CachesLock = SPINLOCK_INIT;
+
+static SlabCache* g_KmallocCaches[KMALLOC_CLASSES];
+static const char* const g_KmallocNames[KMALLOC_CLASSES] = {
+    "kmalloc-8", "kmalloc-16", "kmalloc-32", "kmalloc-64", "kmalloc-128",
+    "kmalloc-256", "kmalloc-512", "kmalloc-1024", "kmalloc-2048",
+};
+
+static inline Slab* SLAB_Of(const void* object){
+    return (Slab*)((uint32_t)object & ~(SLAB_SIZE - 1));
+}
+
+static void SLAB_Unlink(Slab** list, Slab* slab){
+    if(slab->Prev != NULL)
+        slab->Prev->Next = slab->Next;
+    else
+        *list = slab->Next;
+    if(slab->Next != NULL)
+        slab->Next->Prev = slab->Prev;
+}
+
+static void SLAB_Link(Slab** list, Slab* slab){
+    slab->Prev = NULL;
+    slab->Next = *list;
+    if(*list != NULL)
+        (*list)->Prev = slab;
+    *list = slab;
+}
+
+// Returns false, with the cache left unlinked, if its objects don't fit in a slab or align isn't a power of two
+static bool SLAB_SetupCache(SlabCache* cache, const char* name, uint32_t objectSize, uint32_t align){
+    if(align < SLAB_MIN_ALIGN)
+        align = SLAB_MIN_ALIGN;
+    // the rounding below masks with align - 1
+    if(objectSize == 0 || objectSize > SLAB_SIZE || align > SLAB_SIZE || (align & (align - 1)) != 0)
+        return false;
+
+    uint32_t firstObject = (sizeof(Slab) + align - 1) & ~(align - 1);
+    uint32_t size = (objectSize + align - 1) & ~(align - 1);
+    if(firstObject + size > SLAB_SIZE)
+        return false;
+
+    cache->Name = name;
+    cache->ObjectSize = size;
+    cache->FirstObject = firstObject;
+    cache->ObjectsPerSlab = (SLAB_SIZE - firstObject) / size;
+    cache->Lock = (Spinlock)SPINLOCK_INIT;
+    cache->Partial = NULL;
+    cache->Full = NULL;
+    cache->Empty = NULL;
+    cache->SlabCount = 0;
+    cache->InUse = 0;
+    for(uint32_t i = 0; i < SMP_MAX_CPUS; i++){
+        cache->Magazines[i].Count = 0;
+        cache->Magazines[i].Allocations = 0;
+        cache->Magazines[i].Refills = 0;
+    }
+
+    uint32_t flags = SPINLOCK_Acquire(&g_CachesLock);
+    cache->NextCache = g_Caches;
+    g_Caches = cache;
+    SPINLOCK_Release(&g_CachesLock, flags);
+    return true;
+}
+
+// A slab with free objects, NULL if there's no memory for a new one. Cache locked.
+static Slab* SLAB_GetPartial(SlabCache* cache){
+    if(cache->Partial != NULL)
+        return cache->Partial;
+
+    Slab* slab = cache->Empty;
+    if(slab != NULL){
+        cache->Empty = NULL;
+        SLAB_Link(&cache->Partial, slab);
+        return slab;
+    }
+
+    slab = (Slab*)PMM_AllocPages(SLAB_ORDER);
+    if(slab == NULL)
+        return NULL;
+
+    slab->Magic = SLAB_MAGIC;
+    slab->Cache = cache;
+    slab->Order = SLAB_ORDER;
+    slab->InUse = 0;
+
+    // threaded back to front, so objects go out in address order
+    slab->FreeList = NULL;
+    uint8_t* objects = (uint8_t*)slab + cache->FirstObject;
+    for(uint32_t i = cache->ObjectsPerSlab; i-- > 0; ){
+        void** object = (void**)(objects + i * cache->ObjectSize);
+        *object = slab->FreeList;
+        slab->FreeList = object;
+    }
+
+    cache->SlabCount++;
+    SLAB_Link(&cache->Partial, slab);
+    return slab;
+}
+
+// Cache locked
+static void SLAB_ReturnObject(SlabCache* cache, void* object){
+    Slab* slab = SLAB_Of(object);
+    if(slab->InUse == cache->ObjectsPerSlab){
+        SLAB_Unlink(&cache->Full, slab);
+        SLAB_Link(&cache->Partial, slab);
+    }
+
+    *(void**)object = slab->FreeList;
+    slab->FreeList = object;
+    slab->InUse--;
+    cache->InUse--;
+    if(slab->InUse != 0)
+        return;
+
+    // one empty slab is kept around so a cache at the edge doesn't keep hitting the PMM
+    SLAB_Unlink(&cache->Partial, slab);
+    if(cache->Empty == NULL){
+        cache->Empty = slab;
+        slab->Next = NULL;
+        slab->Prev = NULL;
+        return;
+    }
+
+    cache->SlabCount--;
+    slab->Magic = 0;
+    PMM_FreePages((uint32_t)slab, SLAB_ORDER);
+}
+
+// Takes up to SLAB_REFILL_COUNT objects from the slabs. Interrupts disabled.
+static void SLAB_Refill(SlabCache* cache, SlabMagazine* magazine){
+    uint32_t flags = SPINLOCK_Acquire(&cache->Lock);
+    magazine->Refills++;
+
+    while(magazine->Count < SLAB_REFILL_COUNT){
+        Slab* slab = SLAB_GetPartial(cache);
+        if(slab == NULL)
+            break;
+
+        void** object = slab->FreeList;
+        slab->FreeList = *object;
+        slab->InUse++;
+        cache->InUse++;
+        magazine->Objects[magazine->Count++] = object;
+
+        if(slab->FreeList == NULL){
+            SLAB_Unlink(&cache->Partial, slab);
+            SLAB_Link(&cache->Full, slab);
+        }
+    }
+
+    SPINLOCK_Release(&cache->Lock, flags);
+}
+
+// Gives the older half of a full magazine back to the slabs. Interrupts disabled.
+static void SLAB_Flush(SlabCache* cache, SlabMagazine* magazine){
+    uint32_t count = SLAB_MAGAZINE_SIZE / 2;
+
+    uint32_t flags = SPINLOCK_Acquire(&cache->Lock);
+    for(uint32_t i = 0; i < count; i++)
+        SLAB_ReturnObject(cache, magazine->Objects[i]);
+    SPINLOCK_Release(&cache->Lock, flags);
+
+    for(uint32_t i = count; i < magazine->Count; i++)
+        magazine->Objects[i - count] = magazine->Objects[i];
+    magazine->Count -= count;
+}
+
+void SLAB_Initialize(){
+    SLAB_SetupCache(&g_CacheCache, "slab-caches", sizeof(SlabCache), CACHE_LINE_SIZE);
+
+    // kmalloc fails for the sizes of a class that's missing
+    for(int i = 0; i < KMALLOC_CLASSES; i++){
+        g_KmallocCaches[i] = SLAB_CreateCache(g_KmallocNames[i], 1u << (KMALLOC_MIN_SHIFT + i), 0);
+        if(g_KmallocCaches[i] == NULL)
+            LOG_ERROR(LOG_MEMORY, "Slab: no cache for %s", g_KmallocNames[i]);
+    }
+
+    LOG_INFO(LOG_MEMORY, "Slab: %d KiB slabs, kmalloc classes %d to %d bytes, %d object magazines",
+             SLAB_SIZE / 1024, 1 << KMALLOC_MIN_SHIFT, 1 << KMALLOC_MAX_SHIFT, SLAB_MAGAZINE_SIZE);
+}
+
+SlabCache* SLAB_CreateCache(const char* name, uint32_t objectSize, uint32_t align){
+    SlabCache* cache = SLAB_Alloc(&g_CacheCache);
+    if(cache == NULL)
+        return NULL;
+
+    if(!SLAB_SetupCache(cache, name, objectSize, align)){
+        LOG_ERROR(LOG_MEMORY, "Slab: %s objects of %u bytes aligned to %u don't fit in a slab, or the alignment isn't a power of two", name, objectSize, align);
+        SLAB_Free(&g_CacheCache, cache);
+        return NULL;
+    }
+    return cache;
+}
+
+void* SLAB_Alloc(SlabCache* cache){
+    uint32_t flags = i686_SaveInterrupts();
+    SlabMagazine* magazine = &cache->Magazines[i686_CPU_Current()->Index];
+    if(magazine->Count == 0)
+        SLAB_Refill(cache, magazine);
+
+    void* object = NULL;
+    if(magazine->Count != 0){
+        object = magazine->Objects[--magazine->Count];
+        magazine->Allocations++;
+    }
+    i686_RestoreInterrupts(flags);
+    return object;
+}
+
+void SLAB_Free(SlabCache* cache, void* object){
+    Slab* slab = SLAB_Of(object);
+    if(slab->Magic != SLAB_MAGIC || slab->Cache != cache){
+        LOG_ERROR(LOG_MEMORY, "Slab: 0x%x isn't a %s object", (uint32_t)object, cache->Name);
+        return;
+    }
+
+    uint32_t flags = i686_SaveInterrupts();
+    SlabMagazine* magazine = &cache->Magazines[i686_CPU_Current()->Index];
+    if(magazine->Count == SLAB_MAGAZINE_SIZE)
+        SLAB_Flush(cache, magazine);
+    magazine->Objects[magazine->Count++] = object;
+    i686_RestoreInterrupts(flags);
+}
+
+void SLAB_GetStats(const SlabCache* cache, SlabStats* statsOut){
+    uint32_t cached = 0;
+    uint32_t allocations = 0;
+    uint32_t refills = 0;
+    for(uint32_t i = 0; i < SMP_MAX_CPUS; i++){
+        cached += cache->Magazines[i].Count;
+        allocations += cache->Magazines[i].Allocations;
+        refills += cache->Magazines[i].Refills;
+    }
+
+    uint32_t capacity = cache->SlabCount * cache->ObjectsPerSlab;
+    statsOut->Name = cache->Name;
+    statsOut->ObjectSize = cache->ObjectSize;
+    statsOut->ObjectsPerSlab = cache->ObjectsPerSlab;
+    statsOut->ActiveObjects = cache->InUse - cached;
+    statsOut->FreeObjects = capacity - statsOut->ActiveObjects;
+    statsOut->Slabs = cache->SlabCount;
+    statsOut->WasteBytes = cache->SlabCount * (SLAB_SIZE - cache->ObjectsPerSlab * cache->ObjectSize);
+    statsOut->Allocations = allocations;
+    statsOut->Refills = refills;
+}
+
+void SLAB_DumpStats(){
+    uint32_t flags = SPINLOCK_Acquire(&g_CachesLock);
+    for(const SlabCache* cache = g_Caches; cache != NULL; cache = cache->NextCache){
+        SlabStats stats;
+        SLAB_GetStats(cache, &stats);
+        LOG_Printf("[SLAB] %s: %u bytes, %u active, %u free, %u slabs of %u, %u bytes waste, %u allocations, %u refills\r\n",
+                   stats.Name, stats.ObjectSize, stats.ActiveObjects, stats.FreeObjects, stats.Slabs, stats.ObjectsPerSlab,
+                   stats.WasteBytes, stats.Allocations, stats.Refills);
+    }
+    SPINLOCK_Release(&g_CachesLock, flags);
+}
+
+void* kmalloc(size_t size){
+    if(size == 0)
+        return NULL;
+
+    if(size <= (1u << KMALLOC_MAX_SHIFT)){
+        uint32_t shift = size <= (1u << KMALLOC_MIN_SHIFT) ? KMALLOC_MIN_SHIFT : 32 - __builtin_clz(size - 1);
+        SlabCache* cache = g_KmallocCaches[shift - KMALLOC_MIN_SHIFT];
+        return cache != NULL ? SLAB_Alloc(cache) : NULL;
+    }
+
+    if(size > (PAGE_SIZE << PMM_MAX_ORDER) - sizeof(Slab))
+        return NULL;
+
+    // a block of its own, at least slab sized so kfree finds the header the same way
+    uint32_t order = SLAB_ORDER;
+    while((PAGE_SIZE << order) < size + sizeof(Slab))
+        order++;
+
+    Slab* block = (Slab*)PMM_AllocPages(order);
+    if(block == NULL)
+        return NULL;
+
+    block->Magic = SLAB_MAGIC;
+    block->Cache = NULL;
+    block->Order = order;
+    return block + 1;
+}
+
+void kfree(void* pointer){
+    if(pointer == NULL)
+        return;
+
+    Slab* slab = SLAB_Of(pointer);
+    if(slab->Magic != SLAB_MAGIC){
+        LOG_ERROR(LOG_MEMORY, "kfree: 0x%x wasn't allocated by kmalloc", (uint32_t)pointer);
+        return;
+    }
+
+    if(slab->Cache != NULL){
+        SLAB_Free(slab->Cache, pointer);
+        return;
+    }
+
+    slab->Magic = 0;
+    PMM_FreePages((uint32_t)slab, slab->Order);
+}
+
+// kmalloc/kfree pairs that stay in the magazine, then a burst that goes past it to the slabs
+void SLAB_Benchmark(){
+    static void* objects[SLAB_BENCHMARK_OBJECTS];
+
+    uint64_t start = ktime_cycles();
+    for(int i = 0; i < SLAB_BENCHMARK_ROUNDS; i++)
+        kfree(kmalloc(64));
+    uint64_t pair = (ktime_cycles() - start) / SLAB_BENCHMARK_ROUNDS;
+
+    start = ktime_cycles();
+    for(int round = 0; round < SLAB_BENCHMARK_ROUNDS / SLAB_BENCHMARK_OBJECTS; round++){
+        for(int i = 0; i < SLAB_BENCHMARK_OBJECTS; i++)
+            objects[i] = kmalloc(64);
+        for(int i = 0; i < SLAB_BENCHMARK_OBJECTS; i++)
+            kfree(objects[i]);
+    }
+    uint64_t burst = (ktime_cycles() - start) / ((SLAB_BENCHMARK_ROUNDS / SLAB_BENCHMARK_OBJECTS) * SLAB_BENCHMARK_OBJECTS);
+
+    printf("[SLAB] kmalloc + kfree: %u cycles, in bursts of %u: %u cycles\r\n",
+        (uint32_t)pair, SLAB_BENCHMARK_OBJECTS, (uint32_t)burst);
+    SLAB_DumpStats();
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Slab allocator. A cache hands out objects of one size, carved from 16 KiB slabs whose free
+// objects are linked through themselves. Each CPU keeps a small magazine of free objects per
+// cache: most allocations and frees only touch it, with interrupts disabled and no lock.
+// kmalloc rounds up to a power of two size class from 8 to 2048 bytes, anything bigger gets
+// its own PMM block.
+
+#define SLAB_MIN_ALIGN      8
+
+typedef struct SlabCache SlabCache;
+
+typedef struct {
+    const char* Name;
+    uint32_t    ObjectSize;             // Rounded up to the alignment
+    uint32_t    ObjectsPerSlab;
+    uint32_t    ActiveObjects;          // Handed out and not freed yet
+    uint32_t    FreeObjects;            // In the slabs and the magazines
+    uint32_t    Slabs;
+    uint32_t    WasteBytes;             // Slab headers and tails no object fits in
+    uint32_t    Allocations;            // Served from a magazine or not
+    uint32_t    Refills;                // Allocations that had to take the lock
+} SlabStats;
+
+void SLAB_Initialize();
+
+// For hot fixed size objects. align is a power of two, 0 for the default.
+SlabCache* SLAB_CreateCache(const char* name, uint32_t objectSize, uint32_t align);
+
+void* SLAB_Alloc(SlabCache* cache);
+void SLAB_Free(SlabCache* cache, void* object);
+
+void SLAB_GetStats(const SlabCache* cache, SlabStats* statsOut);
+void SLAB_DumpStats();
+void SLAB_Benchmark();
+
+// NULL when out of memory or size is 0. kfree(NULL) does nothing.
+void* kmalloc(size_t size);
+void kfree(void* pointer);
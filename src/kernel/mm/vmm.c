@@ -0,0 +1,594 @@
+#include <mm/vmm.h>
+#include <mm/pmm.h>
+#include <arch/i686/io.h>
+#include <arch/i686/interrupts/isr.h>
+#include <arch/i686/pic/apic.h>
+#include <arch/i686/smp/smp.h>
+#include <arch/generic/cpu.h>
+#include <sched/spinlock.h>
+#include <time/clock.h>
+#include <debug/log.h>
+#include <memory.h>
+#include <stdio.h>
+#include <stddef.h>
+
+#define VMM_ENTRIES             1024
+#define VMM_ADDRESS_MASK        0xFFFFF000
+#define VMM_LARGE_ADDRESS_MASK  0xFFC00000
+
+#define VMM_LOW_MEMORY_END      0x00100000      // BIOS data, the boot stack, VGA, ROMs
+#define VMM_MEMORY_LIMIT        0x100000000ULL  // No PAE
+
+#define VMM_MAX_EARLY_DEVICES   8
+
+// Demand-zero memory comes from the longest run of unmapped 4 MiB chunks in here
+#define VMM_DEMAND_BEGIN        0xC0000000
+#define VMM_DEMAND_END          0xFF000000
+#define VMM_MAX_RESERVATIONS    64
+
+#define VMM_PAGE_FAULT_VECTOR   14
+#define VMM_FLUSH_VECTOR        0xF2
+#define VMM_FLUSH_MAX_PAGES     32              // Above that the other CPUs flush everything
+
+// Page fault error code
+#define VMM_FAULT_PRESENT       (1 << 0)
+#define VMM_FAULT_WRITE         (1 << 1)
+#define VMM_FAULT_RESERVED_BIT  (1 << 3)
+
+#define VMM_BENCHMARK_SIZE      (64 << 20)
+#define VMM_BENCHMARK_PAGES     256
+
+#define CR0_WP                  (1 << 16)
+#define CR0_PG                  (1u << 31)
+#define CR4_PSE                 (1 << 4)
+#define CR4_PGE                 (1 << 7)
+
+#define VMM_DIRECTORY_INDEX(address)    ((address) >> LARGE_PAGE_SHIFT)
+#define VMM_TABLE_INDEX(address)        (((address) >> PAGE_SHIFT) & (VMM_ENTRIES - 1))
+
+typedef struct {
+    uint32_t Begin;
+    uint32_t Size;
+} VMM_Range;
+
+extern uint8_t __entry_start;
+extern uint8_t __data_start;
+extern uint8_t __rodata_start;
+extern uint8_t __bss_start;
+
+static uint32_t g_Directory[VMM_ENTRIES] __attribute__((aligned(PAGE_SIZE)));
+
+static bool g_Enabled;
+static bool g_LargePages;
+static uint32_t g_GlobalFlag;                   // VMM_PAGE_GLOBAL if the CPU has PGE
+static uint32_t g_TableCount;
+
+// Devices mapped before there was a directory to put them in
+static VMM_Range g_EarlyDevices[VMM_MAX_EARLY_DEVICES];
+static uint32_t g_EarlyDeviceCount;
+
+// Demand-zero reservations, sorted, each followed by an unmapped guard page
+static Spinlock g_DemandLock = SPINLOCK_INIT;
+static uint32_t g_DemandBegin;
+static uint32_t g_DemandEnd;
+static uint32_t g_ZeroPage;                     // 0 if there's no demand-zero memory
+static VMM_Range g_Reservations[VMM_MAX_RESERVATIONS];
+static uint32_t g_ReservationCount;
+
+// What the other CPUs flush when asked, set by the holder of g_DemandLock
+static volatile uint32_t g_FlushBegin;
+static volatile uint32_t g_FlushEnd;
+
+static uint32_t g_ZeroFaults;
+static uint32_t g_WriteFaults;
+static uint32_t g_SpuriousFaults;
+static uint32_t g_Flushes;
+
+// Page table for a 4 MiB chunk. A 4 MiB page there is split into the same mapping in 4 KiB pages.
+static uint32_t* VMM_GetTable(uint32_t virt){
+    uint32_t* directoryEntry = &g_Directory[VMM_DIRECTORY_INDEX(virt)];
+    if((*directoryEntry & VMM_PAGE_PRESENT) && !(*directoryEntry & VMM_PAGE_LARGE))
+        return (uint32_t*)(*directoryEntry & VMM_ADDRESS_MASK);
+
+    uint32_t* table = (uint32_t*)PMM_AllocPages(0);
+    if(table == NULL)
+        return NULL;
+
+    if(*directoryEntry & VMM_PAGE_PRESENT){
+        uint32_t base = *directoryEntry & VMM_LARGE_ADDRESS_MASK;
+        uint32_t flags = *directoryEntry & VMM_PAGE_FLAGS_MASK & ~VMM_PAGE_LARGE;
+        for(uint32_t i = 0; i < VMM_ENTRIES; i++)
+            table[i] = (base + (i << PAGE_SHIFT)) | flags;
+    }else{
+        memset(table, 0, PAGE_SIZE);
+    }
+
+    // permissions are up to the table entries
+    uint32_t old = *directoryEntry;
+    *directoryEntry = (uint32_t)table | VMM_PAGE_PRESENT | VMM_PAGE_WRITABLE;
+    if(g_Enabled && (old & VMM_PAGE_LARGE))
+        i686_invlpg(virt & VMM_LARGE_ADDRESS_MASK);
+
+    g_TableCount++;
+    return table;
+}
+
+// Identity maps [begin, end). A 4 MiB chunk entirely inside it gets one large page if 'large'
+// and nothing maps the chunk yet, the rest is mapped in 4 KiB pages.
+static bool VMM_MapRange(uint64_t begin, uint64_t end, uint32_t flags, bool large){
+    if(end > VMM_MEMORY_LIMIT)
+        end = VMM_MEMORY_LIMIT;
+    begin &= ~(uint64_t)(PAGE_SIZE - 1);
+    if(begin < PAGE_SIZE)
+        begin = PAGE_SIZE;
+
+    for(uint64_t chunk = begin & VMM_LARGE_ADDRESS_MASK; chunk < end; chunk += LARGE_PAGE_SIZE){
+        uint32_t* directoryEntry = &g_Directory[VMM_DIRECTORY_INDEX(chunk)];
+        if(large && g_LargePages && *directoryEntry == 0 && chunk >= begin && chunk + LARGE_PAGE_SIZE <= end){
+            *directoryEntry = (uint32_t)chunk | flags | VMM_PAGE_PRESENT | VMM_PAGE_LARGE | g_GlobalFlag;
+            continue;
+        }
+        if(*directoryEntry & VMM_PAGE_LARGE)
+            continue;
+
+        uint64_t first = chunk > begin ? chunk : begin;
+        uint64_t last = chunk + LARGE_PAGE_SIZE < end ? chunk + LARGE_PAGE_SIZE : end;
+        for(uint64_t page = first; page < last; page += PAGE_SIZE){
+            if(VMM_GetMapping((uint32_t)page) == 0 && !VMM_MapPage((uint32_t)page, (uint32_t)page, flags))
+                return false;
+        }
+    }
+    return true;
+}
+
+// The pages entirely inside [begin, end) lose their write permission
+static bool VMM_SetReadOnly(uint32_t begin, uint32_t end){
+    begin = (begin + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    end &= ~(PAGE_SIZE - 1);
+
+    for(uint32_t page = begin; page < end; page += PAGE_SIZE){
+        uint32_t* table = VMM_GetTable(page);
+        if(table == NULL)
+            return false;
+        table[VMM_TABLE_INDEX(page)] &= ~VMM_PAGE_WRITABLE;
+    }
+    return true;
+}
+
+static bool VMM_MapDeviceRange(uint32_t begin, uint32_t size){
+    uint32_t end = begin + size;
+    for(uint32_t page = begin & ~(PAGE_SIZE - 1); page < end; page += PAGE_SIZE){
+        if(!VMM_MapPage(page, page, VMM_PAGE_WRITABLE | VMM_PAGE_UNCACHED | VMM_PAGE_WRITE_THROUGH))
+            return false;
+    }
+    return true;
+}
+
+static void VMM_FlushTLB(CPU* cpu){
+    if(!cpu->TlbFlushPending)
+        return;
+
+    uint32_t begin = g_FlushBegin;
+    uint32_t end = g_FlushEnd;
+    if(((end - begin) >> PAGE_SHIFT) <= VMM_FLUSH_MAX_PAGES){
+        for(uint32_t page = begin; page < end; page += PAGE_SIZE)
+            i686_invlpg(page);
+    }else if(g_GlobalFlag){
+        // toggling PGE drops the global entries too
+        uint32_t cr4 = i686_ReadCR4();
+        i686_WriteCR4(cr4 & ~CR4_PGE);
+        i686_WriteCR4(cr4);
+    }else{
+        i686_WriteCR3(i686_ReadCR3());
+    }
+    __atomic_store_n(&cpu->TlbFlushPending, false, __ATOMIC_RELEASE);
+}
+
+static void VMM_FlushIPIHandler(Registers* regs){
+    VMM_FlushTLB(i686_CPU_Current());
+    APIC_SendEOI(0);
+}
+
+// Waiters answer flush requests, the holder may be waiting on them
+static uint32_t VMM_Lock(){
+    uint32_t flags = i686_SaveInterrupts();
+    CPU* cpu = i686_CPU_Current();
+    while(__atomic_exchange_n(&g_DemandLock.Locked, 1, __ATOMIC_ACQUIRE)){
+        while(g_DemandLock.Locked){
+            VMM_FlushTLB(cpu);
+            __asm__ volatile("pause");
+        }
+    }
+    return flags;
+}
+
+// Makes the other online CPUs drop what they cached of [begin, end). g_DemandLock held.
+static void VMM_FlushOtherCPUs(uint32_t begin, uint32_t end){
+    uint32_t count = i686_SMP_GetCPUCount();
+    if(count < 2)
+        return;
+
+    CPU* self = i686_CPU_Current();
+    g_FlushBegin = begin;
+    g_FlushEnd = end;
+    for(uint32_t i = 0; i < count; i++){
+        CPU* cpu = i686_SMP_GetCPU(i);
+        if(cpu == self || !cpu->Online)
+            continue;
+        __atomic_store_n(&cpu->TlbFlushPending, true, __ATOMIC_RELEASE);
+        APIC_SendIPI(cpu->ApicId, VMM_FLUSH_VECTOR);
+    }
+
+    for(uint32_t i = 0; i < count; i++){
+        CPU* cpu = i686_SMP_GetCPU(i);
+        while(cpu->TlbFlushPending)
+            __asm__ volatile("pause");
+    }
+    g_Flushes++;
+}
+
+static bool VMM_IsReserved(uint32_t virt){
+    for(uint32_t i = 0; i < g_ReservationCount; i++){
+        if(virt >= g_Reservations[i].Begin && virt - g_Reservations[i].Begin < g_Reservations[i].Size)
+            return true;
+    }
+    return false;
+}
+
+static void VMM_PageFault(Registers* regs){
+    uint32_t address = i686_ReadCR2();
+    uint32_t page = address & VMM_ADDRESS_MASK;
+    bool write = (regs->error & VMM_FAULT_WRITE) != 0;
+
+    uint32_t flags = VMM_Lock();
+    if((regs->error & VMM_FAULT_RESERVED_BIT) || !VMM_IsReserved(page)){
+        SPINLOCK_Release(&g_DemandLock, flags);
+        printf("Page fault at 0x%x, error 0x%x\r\n", address, regs->error);
+        i686_ISR_Panic(regs, "Page fault outside demand-zero memory!");
+    }
+
+    // another CPU got here first, or this one still had the read-only entry of the zero page
+    uint32_t entry = VMM_GetMapping(page);
+    if(entry != 0 && (!write || (entry & VMM_PAGE_WRITABLE))){
+        i686_invlpg(page);
+        g_SpuriousFaults++;
+        SPINLOCK_Release(&g_DemandLock, flags);
+        return;
+    }
+
+    if(!write){
+        if(!VMM_MapPage(page, g_ZeroPage, 0))
+            goto outOfMemory;
+        g_ZeroFaults++;
+        SPINLOCK_Release(&g_DemandLock, flags);
+        return;
+    }
+
+    uint32_t frame = PMM_AllocPages(0);
+    if(frame == 0)
+        goto outOfMemory;
+    memset((void*)frame, 0, PAGE_SIZE);
+    if(!VMM_MapPage(page, frame, VMM_PAGE_WRITABLE)){
+        PMM_FreePages(frame, 0);
+        goto outOfMemory;
+    }
+
+    // readers elsewhere would keep seeing the zero page
+    if(entry != 0)
+        VMM_FlushOtherCPUs(page, page + PAGE_SIZE);
+    g_WriteFaults++;
+    SPINLOCK_Release(&g_DemandLock, flags);
+    return;
+
+outOfMemory:
+    SPINLOCK_Release(&g_DemandLock, flags);
+    printf("Page fault at 0x%x, error 0x%x\r\n", address, regs->error);
+    i686_ISR_Panic(regs, "Out of memory for a demand-zero page!");
+}
+
+// The longest run of chunks the identity map left empty, and the page all reads map
+static void VMM_InitializeDemandZero(){
+    uint32_t runBegin = VMM_DEMAND_BEGIN;
+    for(uint32_t chunk = VMM_DEMAND_BEGIN; chunk < VMM_DEMAND_END; chunk += LARGE_PAGE_SIZE){
+        if(g_Directory[VMM_DIRECTORY_INDEX(chunk)] != 0){
+            runBegin = chunk + LARGE_PAGE_SIZE;
+            continue;
+        }
+        if(chunk + LARGE_PAGE_SIZE - runBegin > g_DemandEnd - g_DemandBegin){
+            g_DemandBegin = runBegin;
+            g_DemandEnd = chunk + LARGE_PAGE_SIZE;
+        }
+    }
+
+    g_ZeroPage = g_DemandEnd != g_DemandBegin ? PMM_AllocPages(0) : 0;
+    if(g_ZeroPage == 0){
+        LOG_WARN(LOG_MEMORY, "Paging: no demand-zero memory");
+        return;
+    }
+    memset((void*)g_ZeroPage, 0, PAGE_SIZE);
+
+    i686_ISR_RegisterHandler(VMM_PAGE_FAULT_VECTOR, VMM_PageFault);
+    if(APIC_IsEnabled())
+        i686_ISR_RegisterHandler(VMM_FLUSH_VECTOR, VMM_FlushIPIHandler);
+
+    LOG_INFO(LOG_MEMORY, "Paging: demand-zero memory at 0x%x-0x%x", g_DemandBegin, g_DemandEnd);
+}
+
+bool VMM_Initialize(const BootInfo* bootInfo){
+    unsigned int eax, ebx, ecx, edx;
+    if(__get_cpuid(1, &eax, &ebx, &ecx, &edx)){
+        g_LargePages = (edx & CPUID_FEAT_EDX_PSE) != 0;
+        g_GlobalFlag = (edx & CPUID_FEAT_EDX_PGE) ? VMM_PAGE_GLOBAL : 0;
+    }
+
+    // low memory in 4 KiB pages, VMM_MapRange leaves out page 0
+    bool ok = VMM_GetTable(0) != NULL && VMM_MapRange(0, VMM_LOW_MEMORY_END, VMM_PAGE_WRITABLE, false);
+
+    // RAM, and whatever else the firmware put in the map. Large pages only inside RAM, so they
+    // don't cover holes or straddle a change of memory type, the firmware's ranges are uncached.
+    for(uint32_t i = 0; ok && bootInfo != NULL && i < bootInfo->MemoryRegionCount; i++){
+        const MemoryRegion* region = &bootInfo->MemoryRegions[i];
+        if(region->Type == MEMORY_REGION_BAD || region->Begin >= VMM_MEMORY_LIMIT)
+            continue;
+
+        uint64_t end = region->Begin + region->Length;
+        if(region->Type == MEMORY_REGION_USABLE || region->Type == MEMORY_REGION_ACPI_RECLAIMABLE)
+            ok = VMM_MapRange(region->Begin, end, VMM_PAGE_WRITABLE, true);
+        else
+            ok = VMM_MapRange(region->Begin, end, VMM_PAGE_WRITABLE | VMM_PAGE_UNCACHED | VMM_PAGE_WRITE_THROUGH, false);
+    }
+
+    // kernel code and constants, .data sits in between
+    ok = ok && VMM_SetReadOnly((uint32_t)&__entry_start, (uint32_t)&__data_start)
+            && VMM_SetReadOnly((uint32_t)&__rodata_start, (uint32_t)&__bss_start);
+
+    for(uint32_t i = 0; ok && i < g_EarlyDeviceCount; i++)
+        ok = VMM_MapDeviceRange(g_EarlyDevices[i].Begin, g_EarlyDevices[i].Size);
+
+    if(!ok){
+        LOG_ERROR(LOG_MEMORY, "Paging: out of memory for page tables, paging stays off");
+        return false;
+    }
+
+    VMM_InitializeCPU();
+    g_Enabled = true;
+    VMM_InitializeDemandZero();
+
+    uint32_t largePages = 0;
+    for(uint32_t i = 0; i < VMM_ENTRIES; i++){
+        if(g_Directory[i] & VMM_PAGE_LARGE)
+            largePages++;
+    }
+    LOG_INFO(LOG_MEMORY, "Paging: %u MiB in 4 MiB pages, %u page tables, PSE %s, PGE %s",
+             largePages * (LARGE_PAGE_SIZE >> 20), g_TableCount,
+             g_LargePages ? "on" : "unavailable", g_GlobalFlag ? "on" : "unavailable");
+    return true;
+}
+
+void VMM_InitializeCPU(){
+    if(g_LargePages)
+        i686_WriteCR4(i686_ReadCR4() | CR4_PSE);
+
+    i686_WriteCR3((uint32_t)g_Directory);
+    i686_WriteCR0(i686_ReadCR0() | CR0_PG | CR0_WP);
+
+    // global pages only once paging is on
+    if(g_GlobalFlag)
+        i686_WriteCR4(i686_ReadCR4() | CR4_PGE);
+}
+
+bool VMM_IsEnabled(){
+    return g_Enabled;
+}
+
+bool VMM_MapPage(uint32_t virt, uint32_t phys, uint32_t flags){
+    uint32_t* table = VMM_GetTable(virt);
+    if(table == NULL)
+        return false;
+
+    if(!(flags & VMM_PAGE_USER))
+        flags |= g_GlobalFlag;
+
+    table[VMM_TABLE_INDEX(virt)] = (phys & VMM_ADDRESS_MASK) | (flags & VMM_PAGE_FLAGS_MASK) | VMM_PAGE_PRESENT;
+    if(g_Enabled)
+        i686_invlpg(virt);
+    return true;
+}
+
+void VMM_UnmapPage(uint32_t virt){
+    if(VMM_GetMapping(virt) == 0)
+        return;
+
+    uint32_t* table = VMM_GetTable(virt);
+    if(table == NULL)
+        return;
+
+    table[VMM_TABLE_INDEX(virt)] = 0;
+    if(g_Enabled)
+        i686_invlpg(virt);
+}
+
+uint32_t VMM_GetMapping(uint32_t virt){
+    uint32_t directoryEntry = g_Directory[VMM_DIRECTORY_INDEX(virt)];
+    if(!(directoryEntry & VMM_PAGE_PRESENT))
+        return 0;
+    if(directoryEntry & VMM_PAGE_LARGE)
+        return directoryEntry;
+
+    const uint32_t* table = (const uint32_t*)(directoryEntry & VMM_ADDRESS_MASK);
+    uint32_t entry = table[VMM_TABLE_INDEX(virt)];
+    return (entry & VMM_PAGE_PRESENT) ? entry : 0;
+}
+
+// The demand-zero window gives up the chunks of a device found inside it later (a PCI BAR isn't in
+// the memory map), keeping the side of it with the reservations, or the bigger one. False if there
+// are reservations on both sides, the device can't be identity mapped then.
+static bool VMM_ClaimFromDemandZero(uint32_t phys, uint32_t size){
+    uint64_t begin = phys & VMM_LARGE_ADDRESS_MASK;
+    uint64_t end = ((uint64_t)phys + size + LARGE_PAGE_SIZE - 1) & ~(uint64_t)(LARGE_PAGE_SIZE - 1);
+
+    uint32_t flags = VMM_Lock();
+    if(g_ZeroPage == 0 || end <= g_DemandBegin || begin >= g_DemandEnd){
+        SPINLOCK_Release(&g_DemandLock, flags);
+        return true;
+    }
+
+    uint32_t below = 0;
+    uint32_t above = 0;
+    for(uint32_t i = 0; i < g_ReservationCount; i++){
+        // the guard page after a reservation has to stay outside the device too
+        if((uint64_t)g_Reservations[i].Begin + g_Reservations[i].Size + PAGE_SIZE <= begin)
+            below++;
+        else if(g_Reservations[i].Begin >= end)
+            above++;
+        else
+            below = above = g_ReservationCount;
+    }
+
+    bool ok = below == 0 || above == 0;
+    if(ok){
+        uint64_t belowSize = begin > g_DemandBegin ? begin - g_DemandBegin : 0;
+        uint64_t aboveSize = end < g_DemandEnd ? g_DemandEnd - end : 0;
+        if(below != 0 || (above == 0 && belowSize >= aboveSize))
+            g_DemandEnd = begin > g_DemandBegin ? (uint32_t)begin : g_DemandBegin;
+        else
+            g_DemandBegin = end < g_DemandEnd ? (uint32_t)end : g_DemandEnd;
+    }
+    SPINLOCK_Release(&g_DemandLock, flags);
+
+    if(ok)
+        LOG_INFO(LOG_MEMORY, "Paging: demand-zero memory now at 0x%x-0x%x", g_DemandBegin, g_DemandEnd);
+    return ok;
+}
+
+void VMM_MapDevice(uint32_t phys, uint32_t size){
+    if(g_Enabled){
+        if(!VMM_ClaimFromDemandZero(phys, size))
+            LOG_ERROR(LOG_MEMORY, "Paging: the device at 0x%x is inside demand-zero memory in use", phys);
+        else if(!VMM_MapDeviceRange(phys, size))
+            LOG_ERROR(LOG_MEMORY, "Paging: no page table for the device at 0x%x", phys);
+        return;
+    }
+
+    if(g_EarlyDeviceCount == VMM_MAX_EARLY_DEVICES){
+        LOG_ERROR(LOG_MEMORY, "Paging: too many devices before paging, 0x%x won't be mapped", phys);
+        return;
+    }
+
+    g_EarlyDevices[g_EarlyDeviceCount].Begin = phys;
+    g_EarlyDevices[g_EarlyDeviceCount].Size = size;
+    g_EarlyDeviceCount++;
+}
+
+void* VMM_Reserve(uint32_t size){
+    size = (size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    if(g_ZeroPage == 0 || size == 0)
+        return NULL;
+
+    uint32_t flags = VMM_Lock();
+    if(g_ReservationCount == VMM_MAX_RESERVATIONS || size >= g_DemandEnd - g_DemandBegin){
+        SPINLOCK_Release(&g_DemandLock, flags);
+        return NULL;
+    }
+
+    // first fit, with room for the guard page before the next reservation
+    uint32_t begin = g_DemandBegin;
+    uint32_t i;
+    for(i = 0; i < g_ReservationCount; i++){
+        if(begin <= g_Reservations[i].Begin && g_Reservations[i].Begin - begin >= size + PAGE_SIZE)
+            break;
+        begin = g_Reservations[i].Begin + g_Reservations[i].Size + PAGE_SIZE;
+    }
+    if(i == g_ReservationCount && (begin > g_DemandEnd || g_DemandEnd - begin < size + PAGE_SIZE)){
+        SPINLOCK_Release(&g_DemandLock, flags);
+        return NULL;
+    }
+
+    for(uint32_t j = g_ReservationCount; j > i; j--)
+        g_Reservations[j] = g_Reservations[j - 1];
+    g_Reservations[i].Begin = begin;
+    g_Reservations[i].Size = size;
+    g_ReservationCount++;
+    SPINLOCK_Release(&g_DemandLock, flags);
+    return (void*)begin;
+}
+
+void VMM_Release(void* address){
+    uint32_t flags = VMM_Lock();
+    uint32_t i = 0;
+    while(i < g_ReservationCount && g_Reservations[i].Begin != (uint32_t)address)
+        i++;
+    if(i == g_ReservationCount){
+        SPINLOCK_Release(&g_DemandLock, flags);
+        LOG_ERROR(LOG_MEMORY, "Paging: 0x%x wasn't reserved", (uint32_t)address);
+        return;
+    }
+
+    uint32_t begin = g_Reservations[i].Begin;
+    uint32_t end = begin + g_Reservations[i].Size;
+    g_ReservationCount--;
+    for(uint32_t j = i; j < g_ReservationCount; j++)
+        g_Reservations[j] = g_Reservations[j + 1];
+
+    // the entries keep their frame until no CPU can reach it anymore
+    bool mapped = false;
+    for(uint32_t page = begin; page < end; page += PAGE_SIZE){
+        if(VMM_GetMapping(page) == 0)
+            continue;
+        uint32_t* table = VMM_GetTable(page);
+        table[VMM_TABLE_INDEX(page)] &= ~VMM_PAGE_PRESENT;
+        i686_invlpg(page);
+        mapped = true;
+    }
+    if(mapped)
+        VMM_FlushOtherCPUs(begin, end);
+
+    for(uint32_t page = begin; page < end; page += PAGE_SIZE){
+        if(!(g_Directory[VMM_DIRECTORY_INDEX(page)] & VMM_PAGE_PRESENT))
+            continue;
+        uint32_t* table = VMM_GetTable(page);
+        uint32_t frame = table[VMM_TABLE_INDEX(page)] & VMM_ADDRESS_MASK;
+        if(frame != 0 && frame != g_ZeroPage)
+            PMM_FreePages(frame, 0);
+        table[VMM_TABLE_INDEX(page)] = 0;
+    }
+    SPINLOCK_Release(&g_DemandLock, flags);
+}
+
+// Faults on pages read first, written first, and written after a read, in a sparse buffer
+void VMM_Benchmark(){
+    volatile uint8_t* buffer = VMM_Reserve(VMM_BENCHMARK_SIZE);
+    if(buffer == NULL)
+        return;
+
+    // spread over the buffer, one page in each 256 KiB
+    uint32_t stride = VMM_BENCHMARK_SIZE / VMM_BENCHMARK_PAGES;
+    uint32_t zeroes = 0;
+
+    uint64_t start = ktime_cycles();
+    for(uint32_t i = 0; i < VMM_BENCHMARK_PAGES; i++)
+        zeroes += buffer[i * stride] == 0;
+    uint64_t read = (ktime_cycles() - start) / VMM_BENCHMARK_PAGES;
+
+    start = ktime_cycles();
+    for(uint32_t i = 0; i < VMM_BENCHMARK_PAGES; i++)
+        buffer[i * stride + PAGE_SIZE] = 1;
+    uint64_t write = (ktime_cycles() - start) / VMM_BENCHMARK_PAGES;
+
+    start = ktime_cycles();
+    for(uint32_t i = 0; i < VMM_BENCHMARK_PAGES; i++)
+        buffer[i * stride] = 1;
+    uint64_t upgrade = (ktime_cycles() - start) / VMM_BENCHMARK_PAGES;
+
+    for(uint32_t i = 0; i < VMM_BENCHMARK_PAGES; i++)
+        zeroes += buffer[i * stride + 8] == 0 && buffer[i * stride + PAGE_SIZE + 8] == 0;
+    VMM_Release((void*)buffer);
+
+    if(zeroes != 2 * VMM_BENCHMARK_PAGES)
+        LOG_ERROR(LOG_MEMORY, "Paging: demand-zero pages weren't zero");
+
+    printf("[VMM] demand-zero faults: read %u cycles, write %u cycles, write after read %u cycles\r\n",
+        (uint32_t)read, (uint32_t)write, (uint32_t)upgrade);
+    printf("[VMM] %u KiB reserved, %u KiB committed, %u zero page faults, %u spurious, %u TLB shootdowns\r\n",
+        VMM_BENCHMARK_SIZE >> 10, g_WriteFaults * (PAGE_SIZE >> 10), g_ZeroFaults, g_SpuriousFaults, g_Flushes);
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <boot/bootinfo.h>
+
+// Kernel paging, one address space. What the kernel touches is identity mapped: RAM (the PMM keeps
+// its free lists in the free frames), the firmware's regions of the memory map (uncached), low
+// memory and devices. 4 MiB chunks entirely inside RAM are mapped with PSE pages, all of them
+// global (PGE) so they never leave the TLB. 4 KiB pages everywhere else: the first 4 MiB (page 0
+// stays unmapped to catch NULL, kernel code is read-only), the edges of RAM regions, firmware
+// ranges, device registers, and pages mapped one by one.
+
+#define LARGE_PAGE_SIZE         0x400000
+#define LARGE_PAGE_SHIFT        22
+
+typedef enum {
+    VMM_PAGE_PRESENT            = 1 << 0,
+    VMM_PAGE_WRITABLE           = 1 << 1,
+    VMM_PAGE_USER               = 1 << 2,
+    VMM_PAGE_WRITE_THROUGH      = 1 << 3,
+    VMM_PAGE_UNCACHED           = 1 << 4,
+    VMM_PAGE_ACCESSED           = 1 << 5,
+    VMM_PAGE_DIRTY              = 1 << 6,
+    VMM_PAGE_LARGE              = 1 << 7,       // Directory entries only
+    VMM_PAGE_GLOBAL             = 1 << 8,
+} VMM_PageFlags;
+
+#define VMM_PAGE_FLAGS_MASK     0xFFF
+
+// Builds the kernel directory and turns paging on, needs the PMM for page tables.
+// Returns false, with paging still off, if it couldn't.
+bool VMM_Initialize(const BootInfo* bootInfo);
+
+// Turns paging on for the calling application processor
+void VMM_InitializeCPU();
+
+bool VMM_IsEnabled();
+
+// Maps one 4 KiB page, splitting the 4 MiB page around it if there is one. Kernel mappings are
+// global. Returns false if there was no memory for a page table.
+// Only the calling CPU's TLB is flushed.
+bool VMM_MapPage(uint32_t virt, uint32_t phys, uint32_t flags);
+void VMM_UnmapPage(uint32_t virt);
+
+// The page table entry (or 4 MiB directory entry) that maps virt, 0 if nothing does
+uint32_t VMM_GetMapping(uint32_t virt);
+
+// Maps device registers uncached. Can be called before VMM_Initialize, they are mapped then.
+// Demand-zero memory moves out of the device's way, the mapping fails if it is reserved there.
+void VMM_MapDevice(uint32_t phys, uint32_t size);
+
+// Kernel virtual memory backed on demand, above the identity map. A page read before it's written
+// maps a shared zero page read-only, the first write gets a zeroed frame of its own, so a sparse
+// buffer costs only the pages it touches. Not for kernel stacks: a fault on the stack it runs on
+// can't push its frame.
+// Writing a page that was read first waits for the other CPUs to flush it from their TLBs, don't do
+// that holding a spinlock they may be spinning on.
+// Returns NULL when the area is full. Release takes back the whole reservation and its frames.
+void* VMM_Reserve(uint32_t size);
+void VMM_Release(void* address);
+
+void VMM_Benchmark();
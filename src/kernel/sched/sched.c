@@ -0,0 +1,317 @@
+#include <sched/sched.h>
+#include <arch/i686/interrupts/irq.h>
+#include <sched/work.h>
+#include <arch/i686/io.h>
+#include <mm/pmm.h>
+#include <time/clock.h>
+#include <debug/log.h>
+#include <stdio.h>
+#include <stddef.h>
+
+// Each thread lives in one PMM block: the Thread struct at the bottom, then its FPU area,
+// and the stack growing down from the top.
+#define SCHED_THREAD_ORDER          2                                   // 16 KiB
+#define SCHED_THREAD_SIZE           (PAGE_SIZE << SCHED_THREAD_ORDER)
+
+#define SCHED_BENCHMARK_ROUNDS      10000
+
+#define EFLAGS_IF                   (1 << 9)
+
+// sched_asm.asm
+void __attribute__((cdecl)) SCHED_SwitchContext(uint32_t* oldEsp, uint32_t newEsp);
+
+static Thread* g_RunQueue[SCHED_PRIORITIES];        // Circular lists, the head runs first
+static uint32_t g_RunQueueBitmap;                   // Bit n set if g_RunQueue[n] isn't empty
+
+static Thread g_BootThread;
+static Thread* g_Current = NULL;
+static Thread* g_Idle = NULL;
+static Thread* g_Zombie = NULL;                     // Exited, freed by whoever runs next
+static Timer g_Timeslice;
+static uint32_t g_NextId;
+static uint32_t g_ContextSwitches;
+
+static void SCHED_Enqueue(Thread* thread){
+    Thread** head = &g_RunQueue[thread->Priority];
+    if(*head == NULL){
+        thread->Next = thread;
+        thread->Prev = thread;
+        *head = thread;
+        g_RunQueueBitmap |= 1u << thread->Priority;
+    }else{
+        thread->Next = *head;
+        thread->Prev = (*head)->Prev;
+        thread->Prev->Next = thread;
+        (*head)->Prev = thread;
+    }
+    thread->State = THREAD_READY;
+}
+
+static Thread* SCHED_Dequeue(){
+    if(g_RunQueueBitmap == 0)
+        return g_Idle;
+
+    uint32_t priority = __builtin_ctz(g_RunQueueBitmap);
+    Thread* thread = g_RunQueue[priority];
+    if(thread->Next == thread){
+        g_RunQueue[priority] = NULL;
+        g_RunQueueBitmap &= ~(1u << priority);
+    }else{
+        thread->Prev->Next = thread->Next;
+        thread->Next->Prev = thread->Prev;
+        g_RunQueue[priority] = thread->Next;
+    }
+    return thread;
+}
+
+// True if a ready thread of the same or a higher priority is waiting for the CPU
+static bool SCHED_HasContender(){
+    return (g_RunQueueBitmap & ((2u << g_Current->Priority) - 1)) != 0;
+}
+
+static void SCHED_RequestReschedule(){
+    i686_IRQ_RequestExitWork(IRQ_EXIT_RESCHEDULE);
+}
+
+static void SCHED_TimesliceExpired(Timer* timer, void* context){
+    if(SCHED_HasContender())
+        SCHED_RequestReschedule();
+}
+
+// Frees the thread that exited to get here
+static void SCHED_FinishSwitch(){
+    Thread* zombie = g_Zombie;
+    if(zombie == NULL || zombie == g_Current)
+        return;
+
+    g_Zombie = NULL;
+    i686_FPU_ReleaseContext(&zombie->Fpu);
+    if(zombie->Block != 0)
+        PMM_FreePages(zombie->Block, SCHED_THREAD_ORDER);
+}
+
+// Runs the best ready thread, the current one must already be queued, blocked or dead.
+// Interrupts disabled.
+static void SCHED_Switch(){
+    Thread* previous = g_Current;
+    Thread* next = SCHED_Dequeue();
+    next->State = THREAD_RUNNING;
+    if(next == previous)
+        return;
+
+    // only start a slice if somebody is waiting for one, an idle machine gets no timer interrupts
+    if(next != g_Idle && g_RunQueue[next->Priority] != NULL && !TIMER_Pending(&g_Timeslice))
+        TIMER_Add(&g_Timeslice, SCHED_TIMESLICE_NS, 0);
+
+    g_Current = next;
+    next->Switches++;
+    g_ContextSwitches++;
+    i686_FPU_SwitchTo(&next->Fpu);
+    SCHED_SwitchContext(&previous->Esp, next->Esp);
+
+    SCHED_FinishSwitch();
+}
+
+static void SCHED_ThreadStart(){
+    SCHED_FinishSwitch();
+    i686_sti();
+
+    Thread* thread = g_Current;
+    thread->Entry(thread->Argument);
+    SCHED_Exit();
+}
+
+static void SCHED_SleepExpired(Timer* timer, void* context){
+    SCHED_Wake((Thread*)context);
+}
+
+static void SCHED_WakeupWork(WorkItem* item, void* context){
+    SCHED_Wake((Thread*)context);
+}
+
+static void SCHED_SetupThread(Thread* thread, const char* name, uint8_t priority){
+    thread->Name = name;
+    thread->Priority = priority;
+    thread->Id = g_NextId++;
+    thread->State = THREAD_READY;
+    thread->Switches = 0;
+    TIMER_Setup(&thread->SleepTimer, SCHED_SleepExpired, thread);
+    WORK_Setup(&thread->Wakeup, SCHED_WakeupWork, thread);
+}
+
+static Thread* SCHED_AllocateThread(const char* name, ThreadEntry entry, void* argument, uint8_t priority){
+    uint32_t block = PMM_AllocPages(SCHED_THREAD_ORDER);
+    if(block == 0)
+        return NULL;
+
+    Thread* thread = (Thread*)block;
+    SCHED_SetupThread(thread, name, priority);
+    thread->Block = block;
+    thread->Entry = entry;
+    thread->Argument = argument;
+
+    uint32_t area = (block + sizeof(Thread) + FPU_AREA_ALIGN - 1) & ~(FPU_AREA_ALIGN - 1);
+    i686_FPU_InitContext(&thread->Fpu, (void*)area);
+
+    // what SCHED_SwitchContext pops: edi, esi, ebx, ebp, then it returns into SCHED_ThreadStart
+    uint32_t* stack = (uint32_t*)(block + SCHED_THREAD_SIZE);
+    *--stack = 0;                                   // SCHED_ThreadStart's return address, never used
+    *--stack = (uint32_t)SCHED_ThreadStart;
+    *--stack = 0;
+    *--stack = 0;
+    *--stack = 0;
+    *--stack = 0;
+    thread->Esp = (uint32_t)stack;
+    return thread;
+}
+
+// Also the boot CPU's worker for deferred work nobody's interrupt exit picked up
+static void SCHED_IdleThread(void* argument){
+    for(;;){
+        WORK_Run();
+        SCHED_Preempt();
+        if(!WORK_HasPending())
+            i686_hlt();
+    }
+}
+
+void SCHED_Initialize(){
+    // the boot code keeps its stack, it only needs somewhere to save its FPU state
+    uint32_t area = PMM_AllocPages(0);
+    SCHED_SetupThread(&g_BootThread, "main", SCHED_PRIORITY_DEFAULT);
+    g_BootThread.State = THREAD_RUNNING;
+    i686_FPU_InitContext(&g_BootThread.Fpu, (void*)area);
+
+    TIMER_Setup(&g_Timeslice, SCHED_TimesliceExpired, NULL);
+
+    uint32_t flags = i686_SaveInterrupts();
+    g_Current = &g_BootThread;
+    i686_FPU_SwitchTo(&g_BootThread.Fpu);
+    g_Idle = SCHED_AllocateThread("idle", SCHED_IdleThread, NULL, SCHED_PRIORITY_IDLE);
+    i686_RestoreInterrupts(flags);
+
+    LOG_INFO(LOG_KERNEL, "Scheduler: %d priorities, %u ms slices", SCHED_PRIORITIES, (uint32_t)(SCHED_TIMESLICE_NS / 1000000));
+}
+
+Thread* SCHED_CreateThread(const char* name, ThreadEntry entry, void* argument, uint8_t priority){
+    if(priority >= SCHED_PRIORITY_IDLE)
+        priority = SCHED_PRIORITY_IDLE - 1;
+
+    Thread* thread = SCHED_AllocateThread(name, entry, argument, priority);
+    if(thread == NULL)
+        return NULL;
+
+    thread->State = THREAD_BLOCKED;
+    SCHED_Wake(thread);
+    return thread;
+}
+
+Thread* SCHED_Current(){
+    return g_Current;
+}
+
+void SCHED_Yield(){
+    uint32_t flags = i686_SaveInterrupts();
+    if(g_Current != g_Idle)
+        SCHED_Enqueue(g_Current);
+    SCHED_Switch();
+    i686_RestoreInterrupts(flags);
+}
+
+void SCHED_Preempt(){
+    if(SCHED_HasContender())
+        SCHED_Yield();
+}
+
+void SCHED_RestoreInterrupts(uint32_t flags){
+    // nothing to do while interrupts stay off, that also keeps the console and log locks usable before %gs is set up
+    if(flags & EFLAGS_IF){
+        CPU* cpu = i686_CPU_Current();
+        if(cpu->Index == 0 && !WORK_Running() && (cpu->IRQExitWork & IRQ_EXIT_RESCHEDULE)){
+            cpu->IRQExitWork &= ~IRQ_EXIT_RESCHEDULE;
+            SCHED_Preempt();
+        }
+    }
+    i686_RestoreInterrupts(flags);
+}
+
+void SCHED_Block(){
+    g_Current->State = THREAD_BLOCKED;
+    SCHED_Switch();
+}
+
+void SCHED_Wake(Thread* thread){
+    // the run queues belong to the boot CPU
+    if(i686_CPU_Current()->Index != 0){
+        WORK_QueueOn(0, &thread->Wakeup);
+        return;
+    }
+
+    uint32_t flags = i686_SaveInterrupts();
+    if(thread->State == THREAD_BLOCKED){
+        SCHED_Enqueue(thread);
+
+        if(thread->Priority < g_Current->Priority){
+            // from an interrupt handler the switch has to wait for the EOI, deferred work finishes first
+            if((flags & EFLAGS_IF) && !WORK_Running())
+                SCHED_Yield();
+            else
+                SCHED_RequestReschedule();
+        }else if(thread->Priority == g_Current->Priority && !TIMER_Pending(&g_Timeslice)){
+            TIMER_Add(&g_Timeslice, SCHED_TIMESLICE_NS, 0);
+        }
+    }
+    i686_RestoreInterrupts(flags);
+}
+
+void SCHED_Sleep(uint64_t ns){
+    uint32_t flags = i686_SaveInterrupts();
+    TIMER_Add(&g_Current->SleepTimer, ns, 0);
+    SCHED_Block();
+
+    // woken early by somebody else, the timer mustn't wake the thread out of its next SCHED_Block
+    TIMER_Cancel(&g_Current->SleepTimer);
+    i686_RestoreInterrupts(flags);
+}
+
+void SCHED_Exit(){
+    i686_SaveInterrupts();
+
+    g_Current->State = THREAD_DEAD;
+    TIMER_Cancel(&g_Current->SleepTimer);
+    g_Zombie = g_Current;
+    SCHED_Switch();
+
+    // a dead thread is never picked again
+    for(;;)
+        i686_panic();
+}
+
+static void SCHED_BenchmarkThread(void* argument){
+    for(int i = 0; i < SCHED_BENCHMARK_ROUNDS; i++)
+        SCHED_Yield();
+}
+
+// Two threads yielding to each other, one priority above the caller so it only resumes once both are done
+void SCHED_Benchmark(){
+    uint8_t priority = g_Current->Priority > 0 ? g_Current->Priority - 1 : 0;
+
+    uint32_t flags = i686_SaveInterrupts();
+    if(SCHED_CreateThread("bench0", SCHED_BenchmarkThread, NULL, priority) == NULL
+        || SCHED_CreateThread("bench1", SCHED_BenchmarkThread, NULL, priority) == NULL){
+        SCHED_RestoreInterrupts(flags);
+        printf("[SCHED] Not enough memory for the benchmark\r\n");
+        return;
+    }
+
+    uint32_t switches = g_ContextSwitches;
+    uint64_t start = ktime_cycles();
+    SCHED_Yield();
+    uint64_t cycles = ktime_cycles() - start;
+    switches = g_ContextSwitches - switches;
+    SCHED_RestoreInterrupts(flags);
+
+    uint64_t perSwitch = switches != 0 ? cycles / switches : 0;
+    printf("[SCHED] context switch: %u cycles (%u ns), %u switches\r\n",
+        (uint32_t)perSwitch, (uint32_t)CLOCK_CyclesToNs(perSwitch), switches);
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <arch/i686/fpu/fpu.h>
+#include <time/timer.h>
+#include <sched/work.h>
+
+// Preemptive kernel threads. Priority 0 is the highest, every priority has a FIFO run queue
+// and a bit in a bitmap, so picking the next thread is one BSF. Threads of the same priority
+// share the CPU in SCHED_TIMESLICE_NS slices, higher priority threads preempt as soon as they wake.
+// Threads only run on the boot CPU, the other CPUs run deferred work.
+
+#define SCHED_PRIORITIES            32
+#define SCHED_PRIORITY_DEFAULT      16
+#define SCHED_PRIORITY_IDLE         (SCHED_PRIORITIES - 1)      // Reserved for the idle thread
+
+#define SCHED_TIMESLICE_NS          10000000ULL
+
+typedef void (*ThreadEntry)(void* argument);
+
+typedef enum {
+    THREAD_READY,
+    THREAD_RUNNING,
+    THREAD_BLOCKED,
+    THREAD_DEAD,
+} ThreadState;
+
+typedef struct Thread Thread;
+
+struct Thread{
+    uint32_t        Esp;            // Saved by SCHED_SwitchContext while switched out
+    Thread*         Next;           // Run queue links
+    Thread*         Prev;
+    ThreadState     State;
+    uint8_t         Priority;
+    uint32_t        Id;
+    const char*     Name;
+    ThreadEntry     Entry;
+    void*           Argument;
+    FPUContext      Fpu;
+    Timer           SleepTimer;
+    WorkItem        Wakeup;         // SCHED_Wake from another CPU, handed over to the boot CPU
+    uint32_t        Block;          // PMM block holding this struct, the FPU area and the stack, 0 for the boot thread
+    uint32_t        Switches;       // Times it was switched in
+};
+
+// Turns the code that calls it into the first thread and creates the idle thread. Needs PMM and TIMER.
+void SCHED_Initialize();
+
+// The thread is ready to run right away, NULL if there is no memory for it
+Thread* SCHED_CreateThread(const char* name, ThreadEntry entry, void* argument, uint8_t priority);
+
+Thread* SCHED_Current();
+
+void SCHED_Yield();
+void SCHED_Sleep(uint64_t ns);
+void __attribute__((noreturn)) SCHED_Exit();
+
+// Switches away until SCHED_Wake, call with interrupts disabled after setting up whatever wakes the thread
+void SCHED_Block();
+
+// Safe from interrupt handlers and from any CPU, does nothing unless the thread is blocked
+void SCHED_Wake(Thread* thread);
+
+// Called by i686_IRQ_Exit when an interrupt asked for a reschedule
+void SCHED_Preempt();
+
+// i686_RestoreInterrupts for sections that may wake a thread. A wakeup with interrupts disabled
+// only flags the switch, it happens here once the outermost section turns them back on.
+void SCHED_RestoreInterrupts(uint32_t flags);
+
+void SCHED_Benchmark();
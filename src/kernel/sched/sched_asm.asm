@@ -0,0 +1,22 @@
+; void _cdecl SCHED_SwitchContext(uint32_t* oldEsp, uint32_t newEsp);
+; Only the callee saved registers are kept, the compiler already saved the rest around the call.
+; EFLAGS isn't either: switches happen with interrupts disabled and each thread restores its own.
+
+global SCHED_SwitchContext
+SCHED_SwitchContext:
+    [bits 32]
+    mov eax, [esp + 4]
+    mov edx, [esp + 8]
+
+    push ebp
+    push ebx
+    push esi
+    push edi
+    mov [eax], esp
+
+    mov esp, edx
+    pop edi
+    pop esi
+    pop ebx
+    pop ebp
+    ret
@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+#include <arch/i686/io.h>
+#include <sched/sched.h>
+
+// For data shared between CPUs. Acquiring also disables interrupts on the calling CPU,
+// so an interrupt handler on it can't spin on a lock it already holds. A thread woken while
+// the lock was held gets the CPU on release.
+
+typedef struct {
+    volatile uint32_t Locked;
+} Spinlock;
+
+#define SPINLOCK_INIT   { 0 }
+
+static inline uint32_t SPINLOCK_Acquire(Spinlock* lock){
+    uint32_t flags = i686_SaveInterrupts();
+    while(__atomic_exchange_n(&lock->Locked, 1, __ATOMIC_ACQUIRE)){
+        // wait on a plain read, the xchg would keep bouncing the cache line
+        while(lock->Locked)
+            __asm__ volatile("pause");
+    }
+    return flags;
+}
+
+static inline void SPINLOCK_Release(Spinlock* lock, uint32_t flags){
+    __atomic_store_n(&lock->Locked, 0, __ATOMIC_RELEASE);
+    SCHED_RestoreInterrupts(flags);
+}
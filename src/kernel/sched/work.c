@@ -0,0 +1,144 @@
+#include <sched/work.h>
+#include <arch/i686/interrupts/irq.h>
+#include <arch/i686/pic/apic.h>
+#include <arch/i686/io.h>
+#include <time/clock.h>
+#include <stdio.h>
+
+// Each CPU's queue is a singly linked stack: producers push with cmpxchg, from any context and
+// any CPU, the owning CPU takes the whole list with one xchg and reverses it to run it in order.
+// Whoever pushes onto an empty queue makes sure the owner looks at it.
+
+#define WORK_IPI_VECTOR             0xF1
+#define WORK_BENCHMARK_VECTOR       0x30
+#define WORK_BENCHMARK_ROUNDS       1000
+
+static WorkItem g_BenchmarkItem;
+static volatile bool g_BenchmarkDone;
+
+// Returns whether the queue was empty
+static bool WORK_Push(CPU* cpu, WorkItem* item){
+    WorkItem* head = cpu->WorkQueue;
+    do{
+        item->Next = head;
+    }while(!__atomic_compare_exchange_n(&cpu->WorkQueue, &head, item, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    return head == NULL;
+}
+
+static void WORK_IPIHandler(Registers* regs){
+    APIC_SendEOI(0);
+    i686_IRQ_RequestExitWork(IRQ_EXIT_DEFERRED_WORK);
+}
+
+void WORK_Initialize(){
+    if(APIC_IsEnabled())
+        i686_ISR_RegisterHandler(WORK_IPI_VECTOR, WORK_IPIHandler);
+}
+
+void WORK_Setup(WorkItem* item, WorkFunction function, void* context){
+    item->Next = NULL;
+    item->Pending = 0;
+    item->Function = function;
+    item->Context = context;
+}
+
+bool WORK_Queue(WorkItem* item){
+    if(__atomic_exchange_n(&item->Pending, 1, __ATOMIC_ACQUIRE))
+        return false;
+
+    if(WORK_Push(i686_CPU_Current(), item))
+        i686_IRQ_RequestExitWork(IRQ_EXIT_DEFERRED_WORK);
+    return true;
+}
+
+bool WORK_QueueOn(uint32_t cpuIndex, WorkItem* item){
+    CPU* cpu = i686_SMP_GetCPU(cpuIndex);
+    if(cpu == NULL)
+        return false;
+    if(cpu == i686_CPU_Current())
+        return WORK_Queue(item);
+
+    if(__atomic_exchange_n(&item->Pending, 1, __ATOMIC_ACQUIRE))
+        return false;
+
+    if(WORK_Push(cpu, item))
+        APIC_SendIPI(cpu->ApicId, WORK_IPI_VECTOR);
+    return true;
+}
+
+void WORK_Run(){
+    uint32_t flags = i686_SaveInterrupts();
+    CPU* cpu = i686_CPU_Current();
+    if(cpu->InDeferredWork){
+        i686_RestoreInterrupts(flags);
+        return;
+    }
+
+    cpu->InDeferredWork = true;
+    WorkItem* list;
+    while((list = __atomic_exchange_n(&cpu->WorkQueue, NULL, __ATOMIC_ACQUIRE)) != NULL){
+        // pushed newest first
+        WorkItem* item = NULL;
+        while(list != NULL){
+            WorkItem* next = list->Next;
+            list->Next = item;
+            item = list;
+            list = next;
+        }
+
+        i686_sti();
+        while(item != NULL){
+            // the item may be queued again as soon as Pending is clear, read it before
+            WorkItem* next = item->Next;
+            WorkFunction function = item->Function;
+            void* context = item->Context;
+            __atomic_store_n(&item->Pending, 0, __ATOMIC_RELEASE);
+
+            function(item, context);
+            cpu->WorkItemsRun++;
+            item = next;
+        }
+        i686_cli();
+    }
+    cpu->InDeferredWork = false;
+    i686_RestoreInterrupts(flags);
+}
+
+static void WORK_BenchmarkFunction(WorkItem* item, void* context){
+    g_BenchmarkDone = true;
+}
+
+static void WORK_BenchmarkHandler(Registers* regs){
+    WORK_Queue(&g_BenchmarkItem);
+}
+
+// An interrupt that defers its work, and work handed to another CPU, both until the item ran
+void WORK_Benchmark(){
+    WORK_Setup(&g_BenchmarkItem, WORK_BenchmarkFunction, NULL);
+
+    i686_ISR_RegisterHandler(WORK_BENCHMARK_VECTOR, WORK_BenchmarkHandler);
+    uint64_t start = ktime_cycles();
+    for(int i = 0; i < WORK_BENCHMARK_ROUNDS; i++)
+        __asm__ volatile("int $0x30" ::: "memory");
+    uint64_t local = (ktime_cycles() - start) / WORK_BENCHMARK_ROUNDS;
+    i686_ISR_RegisterHandler(WORK_BENCHMARK_VECTOR, NULL);
+
+    if(i686_SMP_GetCPUCount() < 2 || !APIC_IsEnabled()){
+        printf("[WORK] interrupt + deferred item: %u cycles\r\n", (uint32_t)local);
+        return;
+    }
+
+    uint64_t remote = 0;
+    for(int i = 0; i < WORK_BENCHMARK_ROUNDS; i++){
+        g_BenchmarkDone = false;
+        start = ktime_cycles();
+        WORK_QueueOn(1, &g_BenchmarkItem);
+        while(!g_BenchmarkDone)
+            ;
+        remote += ktime_cycles() - start;
+    }
+
+    printf("[WORK] interrupt + deferred item: %u cycles, queued on CPU 1 until done: %u cycles\r\n",
+        (uint32_t)local, (uint32_t)(remote / WORK_BENCHMARK_ROUNDS));
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <arch/i686/smp/smp.h>
+
+// Deferred work, so interrupt handlers only do the minimum before their EOI. A handler queues
+// an item and returns, the item runs on the same CPU once the EOI went out, with interrupts
+// enabled: on the way out of the interrupt, or from the idle loop if the interrupted code had
+// interrupts disabled. Items live in their owner, queueing never allocates and never locks.
+
+typedef struct WorkItem WorkItem;
+typedef void (*WorkFunction)(WorkItem* item, void* context);
+
+struct WorkItem{
+    WorkItem*           Next;
+    volatile uint32_t   Pending;        // Set while queued, cleared right before the function runs
+    WorkFunction        Function;
+    void*               Context;
+};
+
+// Registers the IPI that tells another CPU it has work
+void WORK_Initialize();
+
+void WORK_Setup(WorkItem* item, WorkFunction function, void* context);
+
+// Queues the item on the calling CPU, safe from any context. Returns false if it was already
+// pending: it then runs once. The function may queue its own item again.
+bool WORK_Queue(WorkItem* item);
+
+// Queues the item on another CPU and interrupts it
+bool WORK_QueueOn(uint32_t cpu, WorkItem* item);
+
+// Runs what is queued on the calling CPU until nothing is left, enabling interrupts in between.
+// Does nothing if called from a work function.
+void WORK_Run();
+
+void WORK_Benchmark();
+
+static inline bool WORK_HasPending(){
+    return i686_CPU_Current()->WorkQueue != NULL;
+}
+
+// True while a work function runs, threads can't be switched then
+static inline bool WORK_Running(){
+    return i686_CPU_Current()->InDeferredWork;
+}
@@ -1,67 +1,137 @@
 #include "stdio.h"
+#include "memory.h"
 #include <arch/i686/io.h>
-#include <stdarg.h>
+#include <sched/spinlock.h>
+#include <debug/log.h>
 
-const unsigned SCREEN_WIDTH = 80;
-const unsigned SCREEN_HEIGHT = 25;
-const uint8_t DEFAULT_COLOR = 0x7;
-uint8_t* g_ScreenBuffer = (uint8_t*)0xB8000;
-int g_ScreenX = 0, g_ScreenY = 0;
+#define SCREEN_WIDTH            80
+#define SCREEN_HEIGHT           25
+#define DEFAULT_COLOR           0x7
 
-void putchr(int x, int y, char c){
-    g_ScreenBuffer[2 * (y * SCREEN_WIDTH + x)] = c;
-}
-void putcolor(int x, int y, uint8_t color){
-    g_ScreenBuffer[2 * (y * SCREEN_WIDTH + x) + 1] = color;
+// The text mode window at 0xB8000 is 32 KiB, the screen is a SCREEN_HEIGHT rows view that slides down it
+#define VRAM_ROWS               (0x8000 / (SCREEN_WIDTH * sizeof(uint16_t)))
+
+#define VGA_CRTC_INDEX          0x3D4
+#define VGA_CRTC_DATA           0x3D5
+#define VGA_CRTC_START_HIGH     0x0C
+#define VGA_CRTC_START_LOW      0x0D
+#define VGA_CRTC_CURSOR_HIGH    0x0E
+#define VGA_CRTC_CURSOR_LOW     0x0F
+
+#define ALL_ROWS                ((1u << SCREEN_HEIGHT) - 1)
+
+#define CELL(chr, color)        ((uint16_t)(uint8_t)(chr) | ((uint16_t)(color) << 8))
+
+static uint16_t* const g_Vram = (uint16_t*)0xB8000;
+
+// Everything is drawn in the shadow buffer first, flush() copies the dirty rows to VRAM.
+// The shadow is a ring of rows, scrolling only moves g_ShadowTop.
+static uint16_t g_Shadow[SCREEN_HEIGHT][SCREEN_WIDTH];
+static int g_ShadowTop = 0;                 // Shadow row shown on the first screen row
+static int g_VramTop = 0;                   // VRAM row the CRTC starts displaying from
+static uint32_t g_DirtyRows = 0;            // Bit y - screen row y changed since the last flush
+static bool g_StartDirty = false;
+static bool g_CursorDirty = false;
+
+static int g_ScreenX = 0, g_ScreenY = 0;
+
+// Everything above, any CPU prints. Characters of different CPUs may interleave, the screen stays whole.
+static Spinlock g_ConsoleLock = SPINLOCK_INIT;
+
+static uint16_t* shadowRow(int y){
+    return g_Shadow[(g_ShadowTop + y) % SCREEN_HEIGHT];
 }
 
-char getchr(int x, int y){
-    return g_ScreenBuffer[2 * (y * SCREEN_WIDTH + x)];
+static void clearRow(uint16_t* row){
+    for(int x = 0; x < SCREEN_WIDTH; x++)
+        row[x] = CELL('\0', DEFAULT_COLOR);
 }
-uint8_t getcolor(int x, int y){
-    return g_ScreenBuffer[2 * (y * SCREEN_WIDTH + x) + 1];
+
+static void writeCRTC(uint8_t highRegister, uint8_t lowRegister, uint16_t value){
+    i686_outb(VGA_CRTC_INDEX, highRegister);
+    i686_outb(VGA_CRTC_DATA, (uint8_t)(value >> 8));
+    i686_outb(VGA_CRTC_INDEX, lowRegister);
+    i686_outb(VGA_CRTC_DATA, (uint8_t)(value & 0xFF));
 }
 
 void clrscr(){
-    for(int y = 0; y < SCREEN_HEIGHT; y++){
-        for(int x = 0; x < SCREEN_WIDTH; x++){
-            putchr(x,y, '\0');
-            putcolor(x,y, DEFAULT_COLOR);
-        }
-    }
+    uint32_t flags = SPINLOCK_Acquire(&g_ConsoleLock);
+    for(int y = 0; y < SCREEN_HEIGHT; y++)
+        clearRow(g_Shadow[y]);
+
+    g_ShadowTop = 0;
+    g_VramTop = 0;
+    g_DirtyRows = ALL_ROWS;
+    g_StartDirty = true;
     g_ScreenX = 0;
     g_ScreenY = 0;
-    setCursor(g_ScreenX,g_ScreenY);
+    g_CursorDirty = true;
+    SPINLOCK_Release(&g_ConsoleLock, flags);
+
+    flush();
 }
 
 void setCursor(int x, int y){
-    int pos = y * SCREEN_WIDTH + x;
-    i686_outb(0x3D4, 0x0F);
-    i686_outb(0x3D5, (uint8_t)(pos & 0xFF));
-    i686_outb(0x3D4, 0x0E);
-    i686_outb(0x3D5, (uint8_t)((pos >> 8) & 0xFF));
+    uint32_t flags = SPINLOCK_Acquire(&g_ConsoleLock);
+    g_ScreenX = x;
+    g_ScreenY = y;
+    g_CursorDirty = true;
+    SPINLOCK_Release(&g_ConsoleLock, flags);
 }
 
-void scrollback(int lines){
+static void scrollback(){
+    g_ShadowTop = (g_ShadowTop + 1) % SCREEN_HEIGHT;
+    clearRow(shadowRow(SCREEN_HEIGHT - 1));
+    g_ScreenY--;
 
-    for(int y = lines; y <= SCREEN_HEIGHT; y++){
-        for(int x = 0; x < SCREEN_WIDTH; x++){
-            putchr(x, y-lines, getchr(x,y));
-            putcolor(x, y-lines, getcolor(x,y));
-        }
+    // the CRTC scrolls for us, until the view reaches the end of VRAM and has to start over from the top
+    g_VramTop++;
+    if(g_VramTop + SCREEN_HEIGHT > VRAM_ROWS){
+        g_VramTop = 0;
+        g_DirtyRows = ALL_ROWS;
+    }else{
+        g_DirtyRows = (g_DirtyRows >> 1) | (1u << (SCREEN_HEIGHT - 1));
     }
 
-    for(int y = SCREEN_HEIGHT - lines; y < SCREEN_HEIGHT; y++){
-        for(int x = 0; x < SCREEN_WIDTH; x++){
-            putchr(x,y, '\0');
-            putcolor(x,y, DEFAULT_COLOR);
+    g_StartDirty = true;
+    g_CursorDirty = true;
+}
+
+void flush(){
+    uint32_t flags = SPINLOCK_Acquire(&g_ConsoleLock);
+    int y = 0;
+    while(y < SCREEN_HEIGHT){
+        if(!(g_DirtyRows & (1u << y))){
+            y++;
+            continue;
         }
+
+        // copy runs of dirty rows at once, as long as they don't wrap around the shadow ring
+        int first = y;
+        const uint16_t* source = shadowRow(first);
+        do{
+            y++;
+        }while(y < SCREEN_HEIGHT && (g_DirtyRows & (1u << y)) && (g_ShadowTop + y) % SCREEN_HEIGHT != 0);
+
+        memcpy(&g_Vram[(g_VramTop + first) * SCREEN_WIDTH], source, (y - first) * SCREEN_WIDTH * sizeof(uint16_t));
     }
-    g_ScreenY -= lines;
+    g_DirtyRows = 0;
+
+    if(g_StartDirty)
+        writeCRTC(VGA_CRTC_START_HIGH, VGA_CRTC_START_LOW, g_VramTop * SCREEN_WIDTH);
+
+    if(g_CursorDirty)
+        writeCRTC(VGA_CRTC_CURSOR_HIGH, VGA_CRTC_CURSOR_LOW, (g_VramTop + g_ScreenY) * SCREEN_WIDTH + g_ScreenX);
+
+    g_StartDirty = false;
+    g_CursorDirty = false;
+    SPINLOCK_Release(&g_ConsoleLock, flags);
+
+    LOG_Flush();
 }
 
-void putc(char c){
-    i686_outb(0xE9, c);
+// g_ConsoleLock held
+static void consolePutc(char c){
     switch (c)
     {
         case '\n':
@@ -69,15 +139,16 @@ void putc(char c){
                 g_ScreenY++;
             break;
         case '\t':
-                for(int i = 0; i < 4 - (g_ScreenX % 4); i++){
-                    putc(' ');
+                for(int spaces = 4 - (g_ScreenX % 4); spaces > 0; spaces--){
+                    consolePutc(' ');
                 }
             break;
         case '\r':
                 g_ScreenX = 0;
             break;
         default:
-            putchr(g_ScreenX,g_ScreenY, c);
+            shadowRow(g_ScreenY)[g_ScreenX] = CELL(c, DEFAULT_COLOR);
+            g_DirtyRows |= 1u << g_ScreenY;
             g_ScreenX++;
             break;
     }
@@ -87,184 +158,15 @@ void putc(char c){
         g_ScreenX = 0;
     }
     if(g_ScreenY >= SCREEN_HEIGHT){
-        scrollback(1);
-    }
-    setCursor(g_ScreenX,g_ScreenY);
-}
-
-void puts(const char* str){
-    while (*str){
-        putc(*str);
-        str++;
-    }
-}
-
-#define PRINTF_STATE_NORMAL             0
-#define PRINTF_STATE_LENGTH             1
-#define PRINTF_STATE_LENGTH_SHORT       2
-#define PRINTF_STATE_LENGTH_LONG        3
-#define PRINTF_STATE_SPEC               4
-
-#define PRINTF_LENGTH_DEFAULT           0
-#define PRINTF_LENGTH_SHORT_SHORT       1
-#define PRINTF_LENGTH_SHORT             2
-#define PRINTF_LENGTH_LONG              3
-#define PRINTF_LENGTH_LONG_LONG         4
-
-
-const char g_HexCharacters[] = "0123456789abcdef";
-
-void printf_unsigned(unsigned long long number, int radix) {
-    char buffer[32];
-    int pos = 0;
-
-    do {
-        unsigned long long rem = number % radix;
-        number /= radix;
-        buffer[pos++] = g_HexCharacters[rem];
-    } while(number > 0);
-
-    while (--pos >= 0)
-        putc(buffer[pos]);
-}
-
-void printf_signed(unsigned long long number, int radix) {
-    if (number < 0){
-        putc('-');
-        printf_unsigned(-number, radix);
-    }else{
-        printf_unsigned(number, radix);
-    }
-}
-
-void printf(const char* fmt, ...){
-
-    va_list args;
-    va_start(args, fmt);
-    int state = PRINTF_STATE_NORMAL;
-    int lenght = PRINTF_LENGTH_DEFAULT;
-    int radix = 10;
-    bool sign = false;
-    bool number = false;
-
-    while (*fmt){
-
-        switch (state)
-        {
-            case PRINTF_STATE_NORMAL:
-                switch (*fmt)
-                {
-                    case '%': state = PRINTF_STATE_LENGTH;
-                              break;
-                    default:  putc(*fmt);
-                              break;
-                }
-                break;
-            case PRINTF_STATE_LENGTH:
-                switch (*fmt)
-                {
-                    case 'h': lenght = PRINTF_LENGTH_SHORT;
-                              state  = PRINTF_STATE_LENGTH_SHORT;
-                              break;
-                    case 'l': lenght = PRINTF_LENGTH_LONG;
-                              state  = PRINTF_STATE_LENGTH_LONG;
-                              break;
-                    default:  goto PRINTF_STATE_SPEC_;
-                              break;
-                }
-                break;
-            case PRINTF_STATE_LENGTH_SHORT:
-                if(*fmt == 'h'){
-                    lenght = PRINTF_LENGTH_SHORT_SHORT;
-                    state  = PRINTF_STATE_SPEC;
-                }else goto PRINTF_STATE_SPEC_;
-                break;
-            case PRINTF_STATE_LENGTH_LONG:
-                if(*fmt == 'l'){
-                    lenght = PRINTF_LENGTH_LONG_LONG;
-                    state  = PRINTF_STATE_SPEC;
-                }else goto PRINTF_STATE_SPEC_;
-                break;
-            case PRINTF_STATE_SPEC:
-            PRINTF_STATE_SPEC_:
-                switch (*fmt)
-                {
-                    case 'c': putc((char)va_arg(args, int));
-                              break;
-                    case 's': puts(va_arg(args, const char*));
-                              break;
-                    case '%': putc('%');
-                              break;
-                    case 'd':
-                    case 'i': radix = 10; sign = true; number = true;
-                              break;
-                    case 'u': radix = 10; sign = false;
-                              break;
-                    case 'X':
-                    case 'x':
-                    case 'p': radix = 16; sign = false; number = true;
-                              break;
-                    case 'o': radix = 8; sign = false; number = true;
-                              break;
-                    default:  break;
-                }
-
-                if(number){
-                    if(sign) {
-                        switch (lenght)
-                        {
-                            case PRINTF_LENGTH_SHORT_SHORT:
-                            case PRINTF_LENGTH_SHORT:
-                            case PRINTF_LENGTH_DEFAULT:
-                                printf_signed(va_arg(args, int), radix);
-                                break;
-                            case PRINTF_LENGTH_LONG:
-                                printf_signed(va_arg(args, long), radix);
-                                break;
-                            case PRINTF_LENGTH_LONG_LONG:
-                                printf_signed(va_arg(args, long long), radix);
-                                break;
-                        }
-                    } else {
-                        switch (lenght)
-                        {
-                            case PRINTF_LENGTH_SHORT_SHORT:
-                            case PRINTF_LENGTH_SHORT:
-                            case PRINTF_LENGTH_DEFAULT:
-                                printf_unsigned(va_arg(args, unsigned int), radix);
-                                break;
-                            case PRINTF_LENGTH_LONG:
-                                printf_unsigned(va_arg(args, unsigned long), radix);
-                                break;
-                            case PRINTF_LENGTH_LONG_LONG:
-                                printf_unsigned(va_arg(args, unsigned long long), radix);
-                                break;
-                        }
-                    }
-                }
-
-                state = PRINTF_LENGTH_DEFAULT;
-                lenght = PRINTF_LENGTH_DEFAULT;
-                radix = 10;
-                sign = false;
-                number = false;
-                break;
-        }
-
-        fmt++;
+        scrollback();
     }
-    va_end(args);
+    g_CursorDirty = true;
 }
 
-void print_buffer(const char* msg, const void* buffer, uint32_t count)
-{
-    const uint8_t* u8Buffer = (const uint8_t*)buffer;
+void putc(char c){
+    LOG_Putc(c);
 
-    puts(msg);
-    for (uint16_t i = 0; i < count; i++)
-    {
-        putc(g_HexCharacters[u8Buffer[i] >> 4]);
-        putc(g_HexCharacters[u8Buffer[i] & 0xF]);
-    }
-    puts("\n");
+    uint32_t flags = SPINLOCK_Acquire(&g_ConsoleLock);
+    consolePutc(c);
+    SPINLOCK_Release(&g_ConsoleLock, flags);
 }
@@ -0,0 +1,90 @@
+#include <time/clock.h>
+#include <arch/i686/timer/pit.h>
+#include <arch/i686/io.h>
+#include <arch/generic/cpu.h>
+#include <debug/log.h>
+
+#define NSEC_PER_SEC                1000000000ULL
+
+#define CPUID_LEAF_POWER            0x80000007
+#define CPUID_POWER_EDX_INVARIANT_TSC (1 << 8)
+
+#define CLOCK_CALIBRATION_MS        10
+#define CLOCK_CALIBRATION_TICKS     (PIT_FREQUENCY * CLOCK_CALIBRATION_MS / 1000)
+#define CLOCK_CALIBRATION_RUNS      5
+
+ClockSource g_Clock;
+
+// TSC cycles elapsed while PIT channel 2 counts CLOCK_CALIBRATION_TICKS
+static uint64_t CLOCK_MeasureTsc(){
+    uint32_t flags = i686_SaveInterrupts();
+
+    i686_PIT_Channel2Start(CLOCK_CALIBRATION_TICKS);
+    uint64_t start = ktime_cycles();
+    while(!i686_PIT_Channel2Expired())
+        ;
+    uint64_t cycles = ktime_cycles() - start;
+
+    i686_RestoreInterrupts(flags);
+    return cycles;
+}
+
+// Median of a few runs, an SMI or a slow port read only skews the runs it lands in
+static uint64_t CLOCK_CalibrateTsc(){
+    uint64_t runs[CLOCK_CALIBRATION_RUNS];
+
+    for(int i = 0; i < CLOCK_CALIBRATION_RUNS; i++){
+        uint64_t cycles = CLOCK_MeasureTsc();
+
+        int j = i;
+        for(; j > 0 && runs[j - 1] > cycles; j--)
+            runs[j] = runs[j - 1];
+        runs[j] = cycles;
+    }
+
+    return runs[CLOCK_CALIBRATION_RUNS / 2] * PIT_FREQUENCY / CLOCK_CALIBRATION_TICKS;
+}
+
+// Largest shift (at most 32) whose multiplier still fits in 32 bits, for the best precision
+static void CLOCK_ComputeMultShift(uint64_t hz, uint32_t* mult, uint32_t* shift){
+    for(uint32_t s = 32; ; s--){
+        uint64_t m = ((NSEC_PER_SEC << s) + hz / 2) / hz;
+        if(m <= UINT32_MAX || s == 0){
+            *mult = (uint32_t)m;
+            *shift = s;
+            return;
+        }
+    }
+}
+
+bool CLOCK_Initialize(){
+    unsigned int eax, ebx, ecx, edx;
+
+    if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(edx & CPUID_FEAT_EDX_TSC)){
+        LOG_ERROR(LOG_KERNEL, "Clock: no TSC, ktime_ns() stays at 0");
+        return false;
+    }
+
+    g_Clock.Invariant = __get_cpuid(CPUID_LEAF_POWER, &eax, &ebx, &ecx, &edx)
+                        && (edx & CPUID_POWER_EDX_INVARIANT_TSC);
+
+    uint64_t hz = CLOCK_CalibrateTsc();
+    if(hz == 0){
+        LOG_ERROR(LOG_KERNEL, "Clock: TSC calibration failed");
+        return false;
+    }
+
+    uint32_t mult, shift;
+    CLOCK_ComputeMultShift(hz, &mult, &shift);
+
+    g_Clock.TscHz = hz;
+    g_Clock.BaseCycles = ktime_cycles();
+    g_Clock.Shift = shift;
+    g_Clock.Mult = mult;
+
+    LOG_INFO(LOG_KERNEL, "Clock: TSC %u kHz%s, mult %u shift %u",
+        (uint32_t)(hz / 1000), g_Clock.Invariant ? " (invariant)" : "", mult, shift);
+    if(!g_Clock.Invariant)
+        LOG_WARN(LOG_KERNEL, "Clock: TSC not reported invariant, time drifts if the frequency changes");
+    return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// Monotonic time from the TSC, calibrated once against the PIT.
+// Converting cycles is a multiply and a shift, ns = (cycles * Mult) >> Shift.
+
+typedef struct {
+    uint64_t    TscHz;
+    uint32_t    Mult;
+    uint32_t    Shift;
+    uint64_t    BaseCycles;     // TSC at CLOCK_Initialize, ktime_ns() counts from here
+    bool        Invariant;      // Constant rate through P/C-states (CPUID 0x80000007 EDX[8])
+} ClockSource;
+
+extern ClockSource g_Clock;
+
+// Until it returns true ktime_ns() and CLOCK_CyclesToNs() return 0
+bool CLOCK_Initialize();
+
+static inline uint64_t ktime_cycles(){
+    uint64_t cycles;
+    __asm__ volatile("rdtsc" : "=A"(cycles));
+    return cycles;
+}
+
+// (value * mult) >> shift without a 96 bit product, exact as long as shift <= 32
+static inline uint64_t CLOCK_MulShift(uint64_t value, uint32_t mult, uint32_t shift){
+    uint64_t low = (uint64_t)(uint32_t)value * mult;
+    uint64_t high = (value >> 32) * mult;
+    return (high << (32 - shift)) + (low >> shift);
+}
+
+static inline uint64_t CLOCK_CyclesToNs(uint64_t cycles){
+    return CLOCK_MulShift(cycles, g_Clock.Mult, g_Clock.Shift);
+}
+
+static inline uint64_t ktime_ns(){
+    return CLOCK_CyclesToNs(ktime_cycles() - g_Clock.BaseCycles);
+}
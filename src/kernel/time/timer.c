@@ -0,0 +1,284 @@
+#include <time/timer.h>
+#include <time/clock.h>
+#include <arch/i686/timer/clockevent.h>
+#include <arch/i686/timer/pit.h>
+#include <arch/i686/pic/apic.h>
+#include <arch/i686/io.h>
+#include <arch/i686/smp/smp.h>
+#include <sched/spinlock.h>
+#include <sched/work.h>
+#include <util/arrays.h>
+#include <debug/log.h>
+#include <stddef.h>
+
+// Wheel ticks are 2^16 ns (65.5 us). Level n has 64 slots of 64^n ticks each, timers further away
+// than the last level covers (~19.5 hours) are parked in it and re-sorted when it comes around.
+// Slots are cascaded into the level below when the one below wraps, so a timer moves at most
+// TIMER_WHEEL_LEVELS - 1 times. Deadlines are rounded up to a tick: a timer never runs early.
+#define TIMER_TICK_SHIFT        16
+#define TIMER_WHEEL_BITS        6
+#define TIMER_WHEEL_SIZE        (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK        (TIMER_WHEEL_SIZE - 1)
+#define TIMER_WHEEL_LEVELS      5
+#define TIMER_WHEEL_SPAN        (1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))
+
+#define TIMER_NO_EVENT          UINT64_MAX
+
+static Timer* g_Wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SIZE];
+static uint64_t g_Occupied[TIMER_WHEEL_LEVELS];     // Bit n set if slot n has timers
+
+static uint64_t g_WheelTick;                        // Every tick up to this one has been run
+static uint64_t g_ProgrammedNs = TIMER_NO_EVENT;    // When the hardware fires next
+static const ClockEventDevice* g_Device = NULL;
+
+// Everything above. The device may be the boot CPU's local APIC timer, other CPUs leave programming it to g_ProgramWork.
+static Spinlock g_TimerLock = SPINLOCK_INIT;
+static WorkItem g_ProgramWork;
+
+// The interrupt only queues this, the wheel runs once the EOI went out
+static WorkItem g_ExpireWork;
+
+static inline uint64_t TIMER_Rotate(uint64_t value, uint32_t count){
+    count &= 63;
+    return count != 0 ? (value >> count) | (value << (64 - count)) : value;
+}
+
+static void TIMER_Link(Timer* timer, int level, int slot){
+    Timer** head = &g_Wheel[level][slot];
+    timer->Next = *head;
+    if(timer->Next != NULL)
+        timer->Next->Link = &timer->Next;
+    timer->Link = head;
+    timer->Slot = level * TIMER_WHEEL_SIZE + slot;
+    *head = timer;
+    g_Occupied[level] |= 1ULL << slot;
+}
+
+static void TIMER_Unlink(Timer* timer){
+    *timer->Link = timer->Next;
+    if(timer->Next != NULL)
+        timer->Next->Link = timer->Link;
+
+    uint32_t level = timer->Slot / TIMER_WHEEL_SIZE;
+    uint32_t slot = timer->Slot % TIMER_WHEEL_SIZE;
+    if(g_Wheel[level][slot] == NULL)
+        g_Occupied[level] &= ~(1ULL << slot);
+
+    timer->Next = NULL;
+    timer->Link = NULL;
+}
+
+// Queues the timer for its deadline, but no earlier than tick 'earliest'
+static void TIMER_Enqueue(Timer* timer, uint64_t earliest){
+    uint64_t tick = (timer->Expires + (1ULL << TIMER_TICK_SHIFT) - 1) >> TIMER_TICK_SHIFT;
+    if(tick < earliest)
+        tick = earliest;
+
+    uint64_t delta = tick - g_WheelTick;
+    if(delta >= TIMER_WHEEL_SPAN){
+        delta = TIMER_WHEEL_SPAN - 1;
+        tick = g_WheelTick + delta;
+    }
+
+    int level = 0;
+    while(delta >= (1ULL << (TIMER_WHEEL_BITS * (level + 1))))
+        level++;
+
+    TIMER_Link(timer, level, (tick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK);
+}
+
+// First tick after g_WheelTick that runs or cascades a slot
+static uint64_t TIMER_NextTick(){
+    uint64_t next = TIMER_NO_EVENT;
+
+    for(int level = 0; level < TIMER_WHEEL_LEVELS; level++){
+        if(g_Occupied[level] == 0)
+            continue;
+
+        uint32_t shift = TIMER_WHEEL_BITS * level;
+        uint64_t block = (g_WheelTick >> shift) + 1;
+        uint64_t pending = TIMER_Rotate(g_Occupied[level], block & TIMER_WHEEL_MASK);
+        uint64_t tick = (block + __builtin_ctzll(pending)) << shift;
+        if(tick < next)
+            next = tick;
+    }
+
+    return next;
+}
+
+static void TIMER_Program(uint64_t now){
+    uint64_t next = TIMER_NextTick();
+    if(next == TIMER_NO_EVENT){
+        g_ProgrammedNs = TIMER_NO_EVENT;
+        return;
+    }
+
+    uint64_t deadline = next << TIMER_TICK_SHIFT;
+    uint64_t delta = deadline > now ? deadline - now : 0;
+    g_ProgrammedNs = now + g_Device->SetNextEvent(delta);
+}
+
+static void TIMER_ProgramWork(WorkItem* item, void* context){
+    uint32_t flags = SPINLOCK_Acquire(&g_TimerLock);
+    TIMER_Program(ktime_ns());
+    SPINLOCK_Release(&g_TimerLock, flags);
+}
+
+// Moves the timers of a slot down the wheel, the ones due now land in level 0's current slot
+static void TIMER_Cascade(int level, int slot){
+    Timer* timer = g_Wheel[level][slot];
+    g_Wheel[level][slot] = NULL;
+    g_Occupied[level] &= ~(1ULL << slot);
+
+    while(timer != NULL){
+        Timer* next = timer->Next;
+        TIMER_Enqueue(timer, g_WheelTick);
+        timer = next;
+    }
+}
+
+// Drops g_TimerLock around each callback
+static void TIMER_Run(int slot, uint64_t now, uint32_t flags){
+    Timer* timer = g_Wheel[0][slot];
+    g_Wheel[0][slot] = NULL;
+    g_Occupied[0] &= ~(1ULL << slot);
+
+    while(timer != NULL){
+        Timer* next = timer->Next;
+        if(next != NULL)
+            next->Link = &g_Wheel[0][slot];
+        timer->Next = NULL;
+        timer->Link = NULL;
+
+        // re-armed before the callback, so the callback can cancel or modify it
+        if(timer->Period != 0){
+            uint64_t missed = (now - timer->Expires) / timer->Period;
+            timer->Expires += (missed + 1) * timer->Period;
+            TIMER_Enqueue(timer, g_WheelTick + 1);
+        }
+
+        // callbacks may cancel the timers after them in this slot
+        g_Wheel[0][slot] = next;
+        SPINLOCK_Release(&g_TimerLock, flags);
+        timer->Callback(timer, timer->Context);
+        SPINLOCK_Acquire(&g_TimerLock);
+        timer = g_Wheel[0][slot];
+        g_Wheel[0][slot] = NULL;
+    }
+}
+
+static void TIMER_ExpireWork(WorkItem* item, void* context){
+    uint32_t flags = SPINLOCK_Acquire(&g_TimerLock);
+    uint64_t now = ktime_ns();
+    uint64_t target = now >> TIMER_TICK_SHIFT;
+    g_ProgrammedNs = TIMER_NO_EVENT;
+
+    // jump straight to the ticks with work, nothing in between needs a cascade
+    while(g_WheelTick < target){
+        uint64_t next = TIMER_NextTick();
+        if(next > target){
+            g_WheelTick = target;
+            break;
+        }
+
+        g_WheelTick = next;
+        for(int level = TIMER_WHEEL_LEVELS - 1; level > 0; level--){
+            uint32_t shift = TIMER_WHEEL_BITS * level;
+            if((g_WheelTick & ((1ULL << shift) - 1)) == 0)
+                TIMER_Cascade(level, (g_WheelTick >> shift) & TIMER_WHEEL_MASK);
+        }
+        TIMER_Run(g_WheelTick & TIMER_WHEEL_MASK, now, flags);
+    }
+
+    TIMER_Program(now);
+    SPINLOCK_Release(&g_TimerLock, flags);
+}
+
+static void TIMER_Interrupt(){
+    WORK_Queue(&g_ExpireWork);
+}
+
+void TIMER_Initialize(){
+    // without a device TIMER_Arm only queues the timers
+    if(g_Clock.Mult == 0){
+        LOG_ERROR(LOG_KERNEL, "Timers: no calibrated clock, timers won't run");
+        return;
+    }
+
+    // in order of preference
+    const ClockEventDevice* devices[] = {
+        APIC_GetClockEvent(),
+        i686_PIT_GetClockEvent(),
+    };
+
+    for(int i = 0; i < SIZE(devices); i++){
+        if(devices[i]->Probe()){
+            g_Device = devices[i];
+            break;
+        }
+    }
+
+    if(g_Device == NULL){
+        LOG_ERROR(LOG_KERNEL, "Timers: no clock event device, timers won't run");
+        return;
+    }
+
+    g_WheelTick = ktime_ns() >> TIMER_TICK_SHIFT;
+    WORK_Setup(&g_ProgramWork, TIMER_ProgramWork, NULL);
+    WORK_Setup(&g_ExpireWork, TIMER_ExpireWork, NULL);
+    g_Device->Initialize(TIMER_Interrupt);
+    LOG_INFO(LOG_KERNEL, "Timers: tickless on the %s", g_Device->Name);
+}
+
+void TIMER_Setup(Timer* timer, TimerCallback callback, void* context){
+    timer->Next = NULL;
+    timer->Link = NULL;
+    timer->Expires = 0;
+    timer->Period = 0;
+    timer->Callback = callback;
+    timer->Context = context;
+}
+
+static bool TIMER_Arm(Timer* timer, uint64_t delayNs){
+    uint64_t now = ktime_ns();
+    bool pending = TIMER_Pending(timer);
+    if(pending)
+        TIMER_Unlink(timer);
+
+    timer->Expires = now + delayNs;
+    TIMER_Enqueue(timer, g_WheelTick + 1);
+
+    // only touch the hardware if this one is due before what it is counting down to
+    if(g_Device != NULL && timer->Expires < g_ProgrammedNs){
+        if(i686_CPU_Current()->Index == 0)
+            TIMER_Program(now);
+        else
+            WORK_QueueOn(0, &g_ProgramWork);
+    }
+    return pending;
+}
+
+void TIMER_Add(Timer* timer, uint64_t delayNs, uint64_t periodNs){
+    uint32_t flags = SPINLOCK_Acquire(&g_TimerLock);
+    timer->Period = periodNs;
+    TIMER_Arm(timer, delayNs);
+    SPINLOCK_Release(&g_TimerLock, flags);
+}
+
+bool TIMER_Modify(Timer* timer, uint64_t delayNs){
+    uint32_t flags = SPINLOCK_Acquire(&g_TimerLock);
+    bool pending = TIMER_Arm(timer, delayNs);
+    SPINLOCK_Release(&g_TimerLock, flags);
+    return pending;
+}
+
+bool TIMER_Cancel(Timer* timer){
+    uint32_t flags = SPINLOCK_Acquire(&g_TimerLock);
+    bool pending = TIMER_Pending(timer);
+    if(pending)
+        TIMER_Unlink(timer);
+    SPINLOCK_Release(&g_TimerLock, flags);
+
+    // the hardware may still fire for it, that interrupt just finds nothing to run
+    return pending;
+}
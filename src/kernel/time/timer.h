@@ -0,0 +1,40 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Kernel timers on a hierarchical timing wheel, O(1) add and cancel.
+// Tickless: the hardware is programmed one-shot for the next expiry only, from the boot CPU.
+// Any CPU can add, modify and cancel timers.
+// Callbacks run as deferred work on the boot CPU, after the timer interrupt's EOI, with interrupts enabled.
+
+typedef struct Timer Timer;
+typedef void (*TimerCallback)(Timer* timer, void* context);
+
+struct Timer{
+    Timer*          Next;
+    Timer**         Link;           // Pointer to this timer in its slot, NULL when not pending
+    uint32_t        Slot;           // Wheel level * 64 + slot, while pending
+    uint64_t        Expires;        // ktime_ns() deadline
+    uint64_t        Period;         // 0 for one-shot timers
+    TimerCallback   Callback;
+    void*           Context;
+};
+
+// Needs CLOCK_Initialize, picks the local APIC timer over the PIT
+void TIMER_Initialize();
+
+void TIMER_Setup(Timer* timer, TimerCallback callback, void* context);
+
+// (Re)arms the timer delayNs from now, then every periodNs if that isn't 0
+void TIMER_Add(Timer* timer, uint64_t delayNs, uint64_t periodNs);
+
+// Moves the deadline of a timer, keeping its period. Returns whether it was pending.
+bool TIMER_Modify(Timer* timer, uint64_t delayNs);
+
+// Returns whether it was pending. A periodic timer can cancel itself from its callback.
+bool TIMER_Cancel(Timer* timer);
+
+static inline bool TIMER_Pending(const Timer* timer){
+    return timer->Link != NULL;
+}
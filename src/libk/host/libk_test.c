@@ -0,0 +1,306 @@
+#define _POSIX_C_SOURCE 199309L  // clock_gettime under -std=c99
+
+// Host-side check of libk against glibc, then a timing of both.
+// The build compiles libk and this file with its functions renamed to libk_*, see src/libk/SConscript.
+
+#include <libk/string.h>
+#include <libk/memory.h>
+#include <libk/stdio.h>
+
+#undef strchr
+#undef strcpy
+#undef strlen
+#undef memchr
+#undef memcpy
+#undef memset
+#undef memcmp
+#undef putc
+#undef flush
+#undef puts
+#undef printf
+#undef print_buffer
+#undef vformat
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+
+#define TEST_MAX_LENGTH         300
+#define TEST_ALIGNMENTS         8
+#define TEST_GUARD              16
+#define TEST_BUFFER_SIZE        (TEST_MAX_LENGTH + TEST_ALIGNMENTS + 2 * TEST_GUARD)
+#define TEST_GUARD_BYTE         0xA5
+
+#define BENCH_MAX_SIZE          65536
+#define BENCH_BYTES             (256u << 20)        // Per function and size
+
+static int g_Failures;
+
+#define CHECK(condition, ...)                   \
+    do{                                         \
+        if(!(condition)){                       \
+            if(g_Failures++ < 20){              \
+                printf("FAIL %s:%d: ", __func__, __LINE__); \
+                printf(__VA_ARGS__);            \
+                printf("\n");                   \
+            }                                   \
+        }                                       \
+    }while(0)
+
+// libk's printf writes through these
+void libk_putc(char c){
+    putchar(c);
+}
+
+void libk_flush(){
+    fflush(stdout);
+}
+
+// Bytes above 0x7f too, they catch signed compares
+static uint8_t TEST_Byte(size_t i){
+    return (uint8_t)(i * 37 + 1) | 1;
+}
+
+static void TEST_Strings(){
+    static char buffer[TEST_BUFFER_SIZE];
+
+    for(size_t align = 0; align < TEST_ALIGNMENTS; align++){
+        for(size_t length = 0; length < TEST_MAX_LENGTH; length++){
+            char* str = buffer + TEST_GUARD + align;
+            for(size_t i = 0; i < length; i++)
+                str[i] = (char)TEST_Byte(i);
+            str[length] = '\0';
+
+            CHECK(libk_strlen(str) == strlen(str), "strlen align %zu length %zu", align, length);
+
+            // every character in the string, one that isn't, and the terminator
+            for(size_t i = 0; i < length; i++)
+                CHECK(libk_strchr(str, str[i]) == strchr(str, str[i]), "strchr align %zu length %zu at %zu", align, length, i);
+            CHECK(libk_strchr(str, (char)0x02) == strchr(str, 0x02), "strchr align %zu length %zu absent", align, length);
+            CHECK(libk_strchr(str, '\0') == strchr(str, '\0'), "strchr align %zu length %zu terminator", align, length);
+        }
+    }
+}
+
+static void TEST_Memchr(){
+    static uint8_t buffer[TEST_BUFFER_SIZE];
+
+    for(size_t align = 0; align < TEST_ALIGNMENTS; align++){
+        for(size_t length = 0; length < TEST_MAX_LENGTH; length++){
+            uint8_t* ptr = buffer + TEST_GUARD + align;
+            for(size_t i = 0; i < length + TEST_GUARD; i++)
+                ptr[i] = TEST_Byte(i);
+
+            for(size_t i = 0; i < length; i += 7)
+                CHECK(libk_memchr(ptr, ptr[i], length) == memchr(ptr, ptr[i], length), "memchr align %zu length %zu at %zu", align, length, i);
+
+            // past the end of the range, and not there at all
+            CHECK(libk_memchr(ptr, ptr[length], length) == memchr(ptr, ptr[length], length), "memchr align %zu length %zu past end", align, length);
+            CHECK(libk_memchr(ptr, 0x00, length) == memchr(ptr, 0x00, length), "memchr align %zu length %zu absent", align, length);
+            CHECK(libk_memchr(ptr, 0x100 | ptr[0], length) == memchr(ptr, 0x100 | ptr[0], length), "memchr align %zu length %zu wide value", align, length);
+        }
+    }
+}
+
+static int TEST_Sign(int value){
+    return (value > 0) - (value < 0);
+}
+
+static void TEST_Memcmp(){
+    static uint8_t buffer1[TEST_BUFFER_SIZE];
+    static uint8_t buffer2[TEST_BUFFER_SIZE];
+
+    for(size_t align1 = 0; align1 < TEST_ALIGNMENTS; align1++){
+        for(size_t align2 = 0; align2 < TEST_ALIGNMENTS; align2++){
+            for(size_t length = 0; length < TEST_MAX_LENGTH; length += 3){
+                uint8_t* ptr1 = buffer1 + TEST_GUARD + align1;
+                uint8_t* ptr2 = buffer2 + TEST_GUARD + align2;
+                for(size_t i = 0; i < length; i++)
+                    ptr1[i] = ptr2[i] = TEST_Byte(i);
+
+                CHECK(libk_memcmp(ptr1, ptr2, length) == 0, "memcmp %zu/%zu length %zu equal", align1, align2, length);
+
+                // 0x01 against 0xff both ways, so the sign is only right if bytes compare unsigned
+                for(size_t i = 0; i < length; i += 5){
+                    uint8_t saved = ptr1[i];
+                    ptr1[i] = 0x01;
+                    ptr2[i] = 0xff;
+                    CHECK(TEST_Sign(libk_memcmp(ptr1, ptr2, length)) == TEST_Sign(memcmp(ptr1, ptr2, length)), "memcmp %zu/%zu length %zu at %zu", align1, align2, length, i);
+                    CHECK(TEST_Sign(libk_memcmp(ptr2, ptr1, length)) == TEST_Sign(memcmp(ptr2, ptr1, length)), "memcmp %zu/%zu length %zu at %zu swapped", align1, align2, length, i);
+                    ptr1[i] = ptr2[i] = saved;
+                }
+            }
+        }
+    }
+}
+
+static void TEST_Memcpy(){
+    static uint8_t source[TEST_BUFFER_SIZE];
+    static uint8_t destination[TEST_BUFFER_SIZE];
+
+    for(size_t i = 0; i < TEST_BUFFER_SIZE; i++)
+        source[i] = TEST_Byte(i);
+
+    for(size_t srcAlign = 0; srcAlign < TEST_ALIGNMENTS; srcAlign++){
+        for(size_t dstAlign = 0; dstAlign < TEST_ALIGNMENTS; dstAlign++){
+            for(size_t length = 0; length < TEST_MAX_LENGTH; length++){
+                memset(destination, TEST_GUARD_BYTE, sizeof(destination));
+                uint8_t* src = source + TEST_GUARD + srcAlign;
+                uint8_t* dst = destination + TEST_GUARD + dstAlign;
+
+                CHECK(libk_memcpy(dst, src, length) == dst, "memcpy return value");
+                CHECK(memcmp(dst, src, length) == 0, "memcpy %zu/%zu length %zu", srcAlign, dstAlign, length);
+                CHECK(dst[-1] == TEST_GUARD_BYTE && dst[length] == TEST_GUARD_BYTE, "memcpy %zu/%zu length %zu wrote outside", srcAlign, dstAlign, length);
+            }
+        }
+    }
+}
+
+static void TEST_Memset(){
+    static uint8_t buffer[TEST_BUFFER_SIZE];
+    static uint8_t expected[TEST_BUFFER_SIZE];
+    static const int values[] = { 0, 0x5a, 0xff, -1, 0x1234 };
+
+    for(size_t v = 0; v < sizeof(values) / sizeof(values[0]); v++){
+        for(size_t align = 0; align < TEST_ALIGNMENTS; align++){
+            for(size_t length = 0; length < TEST_MAX_LENGTH; length++){
+                memset(buffer, TEST_GUARD_BYTE, sizeof(buffer));
+                memset(expected, TEST_GUARD_BYTE, sizeof(expected));
+                uint8_t* ptr = buffer + TEST_GUARD + align;
+
+                CHECK(libk_memset(ptr, values[v], length) == ptr, "memset return value");
+                memset(expected + TEST_GUARD + align, values[v], length);
+                CHECK(memcmp(buffer, expected, sizeof(buffer)) == 0, "memset 0x%x align %zu length %zu", values[v], align, length);
+            }
+        }
+    }
+}
+
+typedef struct {
+    char    Text[128];
+    size_t  Length;
+} TEST_Output;
+
+static void TEST_FormatOutput(char c, void* context){
+    TEST_Output* out = context;
+    if(out->Length < sizeof(out->Text) - 1)
+        out->Text[out->Length++] = c;
+    out->Text[out->Length] = '\0';
+}
+
+static void TEST_Format(const char* expected, const char* fmt, ...){
+    TEST_Output out = { .Length = 0 };
+    out.Text[0] = '\0';
+
+    va_list args;
+    va_start(args, fmt);
+    libk_vformat(TEST_FormatOutput, &out, fmt, args);
+    va_end(args);
+
+    CHECK(strcmp(out.Text, expected) == 0, "format \"%s\": \"%s\", expected \"%s\"", fmt, out.Text, expected);
+}
+
+static void TEST_Printf(){
+    char expected[128];
+
+    snprintf(expected, sizeof(expected), "%lld %lld %lld", LLONG_MIN, LLONG_MAX, -1LL);
+    TEST_Format(expected, "%lld %lld %lld", LLONG_MIN, LLONG_MAX, -1LL);
+
+    snprintf(expected, sizeof(expected), "%d %d %u %x", INT_MIN, INT_MAX, UINT_MAX, 0xdeadbeefu);
+    TEST_Format(expected, "%d %d %u %x", INT_MIN, INT_MAX, UINT_MAX, 0xdeadbeefu);
+
+    snprintf(expected, sizeof(expected), "%llx %s %c", ULLONG_MAX, "libk", 'k');
+    TEST_Format(expected, "%llx %s %c", ULLONG_MAX, "libk", 'k');
+}
+
+// Keeps the compiler from dropping calls whose results aren't used
+static volatile uintptr_t g_Sink;
+
+static double BENCH_Now(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+typedef enum {
+    BENCH_STRLEN,
+    BENCH_MEMCHR,
+    BENCH_MEMCMP,
+    BENCH_MEMCPY,
+    BENCH_MEMSET,
+    BENCH_FUNCTIONS
+} BENCH_Function;
+
+static const char* const g_BenchNames[BENCH_FUNCTIONS] = { "strlen", "memchr", "memcmp", "memcpy", "memset" };
+
+// Bytes per nanosecond
+static double BENCH_Run(BENCH_Function function, bool libk, uint8_t* a, uint8_t* b, size_t size){
+    size_t rounds = BENCH_BYTES / size;
+
+    double start = BENCH_Now();
+    for(size_t i = 0; i < rounds; i++){
+        switch(function){
+            case BENCH_STRLEN:
+                g_Sink += libk ? libk_strlen((const char*)a) : strlen((const char*)a);
+                break;
+            case BENCH_MEMCHR:
+                g_Sink += (uintptr_t)(libk ? libk_memchr(a, 0, size) : memchr(a, 0, size));
+                break;
+            case BENCH_MEMCMP:
+                g_Sink += libk ? libk_memcmp(a, b, size) : memcmp(a, b, size);
+                break;
+            case BENCH_MEMCPY:
+                g_Sink += (uintptr_t)(libk ? libk_memcpy(b, a, size) : memcpy(b, a, size));
+                break;
+            case BENCH_MEMSET:
+                g_Sink += (uintptr_t)(libk ? libk_memset(b, (int)i, size) : memset(b, (int)i, size));
+                break;
+            default:
+                break;
+        }
+    }
+    double seconds = BENCH_Now() - start;
+
+    return (double)rounds * size / (seconds * 1e9);
+}
+
+static void BENCH_All(){
+    static uint8_t a[BENCH_MAX_SIZE + 1];
+    static uint8_t b[BENCH_MAX_SIZE + 1];
+    static const size_t sizes[] = { 16, 256, 4096, BENCH_MAX_SIZE };
+
+    printf("%-8s %8s %12s %12s\n", "", "bytes", "libk GB/s", "glibc GB/s");
+    for(int function = 0; function < BENCH_FUNCTIONS; function++){
+        for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++){
+            size_t size = sizes[s];
+
+            // strlen and memchr run to the end, memcmp compares equal buffers
+            memset(a, 'x', size);
+            a[size] = '\0';
+            memset(b, 'x', size);
+
+            double libk = BENCH_Run(function, true, a, b, size);
+            double glibc = BENCH_Run(function, false, a, b, size);
+            printf("%-8s %8zu %12.2f %12.2f\n", g_BenchNames[function], size, libk, glibc);
+        }
+    }
+}
+
+int main(){
+    TEST_Strings();
+    TEST_Memchr();
+    TEST_Memcmp();
+    TEST_Memcpy();
+    TEST_Memset();
+    TEST_Printf();
+
+    if(g_Failures != 0){
+        printf("libk: %d checks failed\n", g_Failures);
+        return 1;
+    }
+    printf("libk: all checks passed\n");
+
+    BENCH_All();
+    return 0;
+}
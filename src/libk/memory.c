@@ -0,0 +1,63 @@
+#include <libk/memory.h>
+#include "word.h"
+
+void * memcpy(void * dst, const void * src, size_t num){
+    uint8_t* u8Dst = (uint8_t *)dst;
+    const uint8_t* u8Src = (const uint8_t *)src;
+
+    // x86 doesn't mind unaligned loads, aligning the stores is enough
+    while(num > 0 && !WORD_IS_ALIGNED(u8Dst)){
+        *u8Dst++ = *u8Src++;
+        --num;
+    }
+
+    word_t* wDst = (word_t *)u8Dst;
+    const word_t* wSrc = (const word_t *)u8Src;
+    for(; num >= WORD_SIZE; num -= WORD_SIZE)
+        *wDst++ = *wSrc++;
+
+    u8Dst = (uint8_t *)wDst;
+    u8Src = (const uint8_t *)wSrc;
+    while(num-- > 0)
+        *u8Dst++ = *u8Src++;
+
+    return dst;
+}
+
+void * memset(void * ptr, int value, size_t num){
+    uint8_t * u8Ptr = (uint8_t *)ptr;
+
+    while(num > 0 && !WORD_IS_ALIGNED(u8Ptr)){
+        *u8Ptr++ = (uint8_t)value;
+        --num;
+    }
+
+    const word_t pattern = WORD_REPEAT(value);
+    word_t* wPtr = (word_t *)u8Ptr;
+    for(; num >= WORD_SIZE; num -= WORD_SIZE)
+        *wPtr++ = pattern;
+
+    u8Ptr = (uint8_t *)wPtr;
+    while(num-- > 0)
+        *u8Ptr++ = (uint8_t)value;
+
+    return ptr;
+}
+
+int memcmp(const void * ptr1, const void * ptr2, size_t num){
+    const uint8_t* u8Ptr1 = (const uint8_t *)ptr1;
+    const uint8_t* u8Ptr2 = (const uint8_t *)ptr2;
+
+    // skip the equal words, the bytes of the first different one are compared below
+    while(num >= WORD_SIZE && *(const word_t*)u8Ptr1 == *(const word_t*)u8Ptr2){
+        u8Ptr1 += WORD_SIZE;
+        u8Ptr2 += WORD_SIZE;
+        num -= WORD_SIZE;
+    }
+
+    for (; num > 0; num--, u8Ptr1++, u8Ptr2++)
+        if (*u8Ptr1 != *u8Ptr2)
+            return (int)*u8Ptr1 - (int)*u8Ptr2;
+
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include <libk/string.h>
+#include "word.h"
+
+// Aligned words never cross a page, so reading past the terminator inside the last one is safe
+
+const char* strchr(const char* str, char chr){
+    if(str == NULL) return NULL;
+
+    while(!WORD_IS_ALIGNED(str)){
+        if(*str == chr) return str;
+        if(*str == '\0') return NULL;
+        ++str;
+    }
+
+    const word_t pattern = WORD_REPEAT(chr);
+    const word_t* words = (const word_t*)str;
+    while(!WORD_HAS_ZERO(*words) && !WORD_HAS_ZERO(*words ^ pattern))
+        ++words;
+
+    // the match or the terminator is in this word
+    for(str = (const char*)words; ; ++str){
+        if(*str == chr) return str;
+        if(*str == '\0') return NULL;
+    }
+}
+
+char* strcpy(char* dst, const char* src){
+
+    char* orginalDst = dst;
+
+    if (dst == NULL) return NULL;
+
+    if (src == NULL){
+        *dst = '\0';
+        return dst;
+    }
+    while(*src){
+        *dst = *src;
+        ++src;
+        ++dst;
+    }
+    *dst = '\0';
+    return orginalDst;
+}
+
+size_t strlen(const char* str){
+    const char* start = str;
+
+    while(!WORD_IS_ALIGNED(str)){
+        if(*str == '\0') return str - start;
+        ++str;
+    }
+
+    const word_t* words = (const word_t*)str;
+    while(!WORD_HAS_ZERO(*words))
+        ++words;
+
+    for(str = (const char*)words; *str; ++str);
+    return str - start;
+}
+
+const void* memchr(const void* ptr, int value, size_t num){
+    const uint8_t* u8Ptr = (const uint8_t*)ptr;
+    const uint8_t byte = (uint8_t)value;
+
+    while(num > 0 && !WORD_IS_ALIGNED(u8Ptr)){
+        if(*u8Ptr == byte) return u8Ptr;
+        ++u8Ptr;
+        --num;
+    }
+
+    const word_t pattern = WORD_REPEAT(byte);
+    const word_t* words = (const word_t*)u8Ptr;
+    while(num >= WORD_SIZE && !WORD_HAS_ZERO(*words ^ pattern)){
+        ++words;
+        num -= WORD_SIZE;
+    }
+
+    for(u8Ptr = (const uint8_t*)words; num > 0; ++u8Ptr, --num){
+        if(*u8Ptr == byte) return u8Ptr;
+    }
+    return NULL;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Helpers for the word-at-a-time string and memory functions
+
+// Allowed to alias any other type, like char is
+typedef uint32_t __attribute__((may_alias)) word_t;
+
+#define WORD_SIZE           sizeof(word_t)
+#define WORD_ONES           0x01010101u
+#define WORD_HIGHS          0x80808080u
+
+// Every byte of the word set to 'byte'
+#define WORD_REPEAT(byte)   ((word_t)(uint8_t)(byte) * WORD_ONES)
+
+// Non zero if any byte of the word is zero
+#define WORD_HAS_ZERO(word) (((word) - WORD_ONES) & ~(word) & WORD_HIGHS)
+
+#define WORD_IS_ALIGNED(ptr) (((uintptr_t)(ptr) & (WORD_SIZE - 1)) == 0)